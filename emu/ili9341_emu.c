@@ -0,0 +1,602 @@
+/*
+ * ILI9341 controller emulator
+ *
+ * Author: Michal Horn
+ */
+
+#include <stdio.h>
+#include "string.h"
+#include "ili9341_emu.h"
+#include "ili9341_spi_cmds.h"
+
+#define ILI9341_EMU_MAX_PARAMS (16)	/**< Parameters kept per command, the rest is ignored. */
+
+#define ILI9341_EMU_MADCTL_MY 0x80
+#define ILI9341_EMU_MADCTL_MX 0x40
+#define ILI9341_EMU_MADCTL_MV 0x20
+#define ILI9341_EMU_MADCTL_BGR 0x08
+
+/**
+ * Definition of the emulator instance.
+ */
+struct ili9341_emu {
+	ili9341_emu_cfg_t cfg;
+	ili9341_desc_ptr_t desc;
+	/* Bus */
+	bool cs;
+	bool dc;
+	bool rst;
+	bool busy;
+	uint64_t now_ns;
+	uint64_t busy_until_ns;
+	uint64_t stats_base_ns;
+	/* Command decoder */
+	uint8_t cmd;
+	uint8_t params[ILI9341_EMU_MAX_PARAMS];
+	uint8_t params_cnt;
+	uint8_t pixel[3];
+	uint8_t pixel_cnt;
+	/* Registers */
+	uint8_t madctl;
+	uint8_t pixfmt;
+	uint16_t sc, ec, sp, ep;
+	uint16_t col, page;
+	bool sleep;
+	bool display_on;
+	bool inverted;
+	bool idle;
+	bool partial;
+	uint16_t partial_sr, partial_er;
+	bool scrolling;
+	uint16_t scroll_tfa, scroll_vsa, scroll_vsp;
+	bool te_on;
+	uint16_t te_line;
+	/* RGB666 frame memory, one byte per channel. */
+	uint8_t gram[ILI9341_EMU_GRAM_HEIGHT][ILI9341_EMU_GRAM_WIDTH][3];
+	ili9341_emu_stats_t stats;
+};
+
+/**
+ * Emulators pool, the HAL callbacks have no context so each emulator has its own set.
+ */
+struct ili9341_emu_pool_st {
+	struct ili9341_emu emus[ILI9341_EMU_MAX_CNT];
+	uint8_t current_emu;
+};
+
+static struct ili9341_emu_pool_st ili9341_emu_pool;
+
+/* Private methods. */
+
+/*
+ * Count a millisecond of the simulated time to the attached driver instance
+ * only, the other emulators keep their own time. A lone emulator ticks all
+ * instances until attached, so ili9341_init can wait out its delays.
+ */
+void _ili9341_emu_tick(ili9341_emu_ptr_t emu) {
+	if (emu->desc != NULL) {
+		ili9341_1ms_tick(emu->desc);
+	} else if (ili9341_emu_pool.current_emu == 1) {
+		ili9341_1ms_timer_cb();
+	}
+}
+
+void _ili9341_emu_advance(ili9341_emu_ptr_t emu, uint64_t ns) {
+	uint64_t before_ms = emu->now_ns / 1000000;
+	emu->now_ns += ns;
+
+	if (emu->cfg.tick) {
+		for (uint64_t ms = before_ms; ms < emu->now_ns / 1000000; ms++) {
+			_ili9341_emu_tick(emu);
+		}
+	}
+}
+
+void _ili9341_emu_hw_reset(ili9341_emu_ptr_t emu) {
+	emu->cmd = ILI9341_CMD_NOP;
+	emu->params_cnt = 0;
+	emu->pixel_cnt = 0;
+	emu->madctl = 0x00;
+	emu->pixfmt = ILI9341_PIXFMT_18BIT;
+	emu->sc = 0;
+	emu->ec = ILI9341_EMU_GRAM_WIDTH - 1;
+	emu->sp = 0;
+	emu->ep = ILI9341_EMU_GRAM_HEIGHT - 1;
+	emu->col = 0;
+	emu->page = 0;
+	emu->sleep = true;
+	emu->display_on = false;
+	emu->inverted = false;
+	emu->idle = false;
+	emu->partial = false;
+	emu->partial_sr = 0;
+	emu->partial_er = ILI9341_EMU_GRAM_HEIGHT - 1;
+	emu->scrolling = false;
+	emu->scroll_tfa = 0;
+	emu->scroll_vsa = ILI9341_EMU_GRAM_HEIGHT;
+	emu->scroll_vsp = 0;
+	emu->te_on = false;
+	emu->te_line = 0;
+}
+
+/*
+ * Frame memory position of a column and page address, as set by MADCTL.
+ */
+void _ili9341_emu_map(uint8_t madctl, uint16_t col, uint16_t page, uint16_t* x, uint16_t* y) {
+	*x = (madctl & ILI9341_EMU_MADCTL_MV) ? page : col;
+	*y = (madctl & ILI9341_EMU_MADCTL_MV) ? col : page;
+	if (madctl & ILI9341_EMU_MADCTL_MX) {
+		*x = ILI9341_EMU_GRAM_WIDTH - 1 - *x;
+	}
+	if (madctl & ILI9341_EMU_MADCTL_MY) {
+		*y = ILI9341_EMU_GRAM_HEIGHT - 1 - *y;
+	}
+}
+
+void _ili9341_emu_write_pixel(ili9341_emu_ptr_t emu, const uint8_t* rgb666) {
+	uint16_t x, y;
+	_ili9341_emu_map(emu->madctl, emu->col, emu->page, &x, &y);
+	if (x < ILI9341_EMU_GRAM_WIDTH && y < ILI9341_EMU_GRAM_HEIGHT) {
+		memcpy(emu->gram[y][x], rgb666, 3);
+	}
+	emu->stats.pixels++;
+
+	if (emu->col >= emu->ec) {
+		emu->col = emu->sc;
+		emu->page = (emu->page >= emu->ep) ? emu->sp : emu->page + 1;
+	} else {
+		emu->col++;
+	}
+}
+
+void _ili9341_emu_pixel_byte(ili9341_emu_ptr_t emu, uint8_t byte) {
+	bool rgb565 = (emu->pixfmt & 0x07) != ILI9341_PIXFMT_18BIT_DBI;
+	emu->pixel[emu->pixel_cnt++] = byte;
+
+	if (rgb565 && emu->pixel_cnt == 2) {
+		uint16_t color = ((uint16_t)emu->pixel[0] << 8) | emu->pixel[1];
+		uint8_t r = color >> 11, g = (color >> 5) & 0x3F, b = color & 0x1F;
+		uint8_t rgb666[3] = {(r << 1) | (r >> 4), g, (b << 1) | (b >> 4)};
+		_ili9341_emu_write_pixel(emu, rgb666);
+		emu->pixel_cnt = 0;
+	} else if (emu->pixel_cnt == 3) {
+		uint8_t rgb666[3] = {emu->pixel[0] >> 2, emu->pixel[1] >> 2, emu->pixel[2] >> 2};
+		_ili9341_emu_write_pixel(emu, rgb666);
+		emu->pixel_cnt = 0;
+	}
+}
+
+uint16_t _ili9341_emu_param16(ili9341_emu_ptr_t emu, uint8_t idx) {
+	return ((uint16_t)emu->params[idx] << 8) | emu->params[idx + 1];
+}
+
+/*
+ * Apply the command once its last parameter arrived.
+ */
+void _ili9341_emu_apply(ili9341_emu_ptr_t emu) {
+	switch (emu->cmd) {
+	case ILI9341_CMD_CASET:
+		if (emu->params_cnt == 4) {
+			emu->sc = _ili9341_emu_param16(emu, 0);
+			emu->ec = _ili9341_emu_param16(emu, 2);
+		}
+		break;
+	case ILI9341_CMD_PASET:
+		if (emu->params_cnt == 4) {
+			emu->sp = _ili9341_emu_param16(emu, 0);
+			emu->ep = _ili9341_emu_param16(emu, 2);
+		}
+		break;
+	case ILI9341_CMD_PARTAR:
+		if (emu->params_cnt == 4) {
+			emu->partial_sr = _ili9341_emu_param16(emu, 0);
+			emu->partial_er = _ili9341_emu_param16(emu, 2);
+		}
+		break;
+	case ILI9341_CMD_VSCRDEF:
+		if (emu->params_cnt == 6) {
+			emu->scroll_tfa = _ili9341_emu_param16(emu, 0);
+			emu->scroll_vsa = _ili9341_emu_param16(emu, 2);
+		}
+		break;
+	case ILI9341_CMD_VSCRSADD:
+		if (emu->params_cnt == 2) {
+			emu->scroll_vsp = _ili9341_emu_param16(emu, 0);
+			emu->scrolling = true;
+		}
+		break;
+	case ILI9341_CMD_MADCTL:
+		if (emu->params_cnt == 1) {
+			emu->madctl = emu->params[0];
+		}
+		break;
+	case ILI9341_CMD_PIXFMT:
+		if (emu->params_cnt == 1) {
+			emu->pixfmt = emu->params[0];
+		}
+		break;
+	case ILI9341_CMD_TEARON:
+		if (emu->params_cnt == 1) {
+			emu->te_on = true;
+		}
+		break;
+	case ILI9341_CMD_SETTEARSL:
+		if (emu->params_cnt == 2) {
+			emu->te_line = _ili9341_emu_param16(emu, 0);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void _ili9341_emu_command(ili9341_emu_ptr_t emu, uint8_t cmd) {
+	emu->stats.commands++;
+	emu->cmd = cmd;
+	emu->params_cnt = 0;
+	emu->pixel_cnt = 0;
+
+	switch (cmd) {
+	case ILI9341_CMD_SWRESET:
+		_ili9341_emu_hw_reset(emu);
+		break;
+	case ILI9341_CMD_SLPIN:
+		emu->sleep = true;
+		break;
+	case ILI9341_CMD_SLPOUT:
+		emu->sleep = false;
+		break;
+	case ILI9341_CMD_PTLON:
+		emu->partial = true;
+		emu->scrolling = false;
+		break;
+	case ILI9341_CMD_NORON:
+		emu->partial = false;
+		emu->scrolling = false;
+		break;
+	case ILI9341_CMD_INVOFF:
+		emu->inverted = false;
+		break;
+	case ILI9341_CMD_INVON:
+		emu->inverted = true;
+		break;
+	case ILI9341_CMD_DISPOFF:
+		emu->display_on = false;
+		break;
+	case ILI9341_CMD_DISPON:
+		emu->display_on = true;
+		break;
+	case ILI9341_CMD_RAMWR:
+		emu->col = emu->sc;
+		emu->page = emu->sp;
+		break;
+	case ILI9341_CMD_TEAROFF:
+		emu->te_on = false;
+		break;
+	case ILI9341_CMD_IDLEOFF:
+		emu->idle = false;
+		break;
+	case ILI9341_CMD_IDLEON:
+		emu->idle = true;
+		break;
+	default:
+		break;
+	}
+}
+
+void _ili9341_emu_data(ili9341_emu_ptr_t emu, uint8_t byte) {
+	if (emu->cmd == ILI9341_CMD_RAMWR || emu->cmd == ILI9341_CMD_RAMWRCONT) {
+		_ili9341_emu_pixel_byte(emu, byte);
+		return;
+	}
+
+	if (emu->params_cnt < ILI9341_EMU_MAX_PARAMS) {
+		emu->params[emu->params_cnt++] = byte;
+		_ili9341_emu_apply(emu);
+	}
+}
+
+/*
+ * Account a transfer of len bytes. Returns false on a protocol violation, the data is dropped then.
+ */
+bool _ili9341_emu_transfer_start(ili9341_emu_ptr_t emu, uint32_t len) {
+	emu->stats.hal_calls++;
+	if (emu->cs || !emu->rst || (emu->busy && emu->now_ns < emu->busy_until_ns)) {
+		emu->stats.errors++;
+		return false;
+	}
+
+	uint64_t start = (emu->busy_until_ns > emu->now_ns) ? emu->busy_until_ns : emu->now_ns;
+	uint64_t duration = emu->cfg.xfer_overhead_ns + (uint64_t)len * 8 * 1000000000ULL / emu->cfg.spi_hz;
+	emu->busy_until_ns = start + duration;
+	emu->busy = true;
+	emu->stats.transfers++;
+	emu->stats.bytes += len;
+	emu->stats.bus_ns += duration;
+	return true;
+}
+
+void _ili9341_emu_bytes(ili9341_emu_ptr_t emu, const uint8_t* data, uint32_t len) {
+	for (uint32_t i = 0; i < len; i++) {
+		if (emu->dc) {
+			_ili9341_emu_data(emu, data[i]);
+		} else {
+			_ili9341_emu_command(emu, data[i]);
+		}
+	}
+}
+
+int _ili9341_emu_tx(ili9341_emu_ptr_t emu, const uint8_t* data, uint32_t length) {
+	if (_ili9341_emu_transfer_start(emu, length)) {
+		_ili9341_emu_bytes(emu, data, length);
+	}
+	return 0;
+}
+
+int _ili9341_emu_tx_repeat(ili9341_emu_ptr_t emu, const uint8_t* pattern, uint32_t count) {
+	if (_ili9341_emu_transfer_start(emu, count * ILI9341_REPEAT_PATTERN_LEN)) {
+		for (uint32_t i = 0; i < count; i++) {
+			_ili9341_emu_bytes(emu, pattern, ILI9341_REPEAT_PATTERN_LEN);
+		}
+	}
+	return 0;
+}
+
+int _ili9341_emu_tx_sg(ili9341_emu_ptr_t emu, const ili9341_seg_t* segs, uint16_t cnt) {
+	uint32_t len = 0;
+	for (uint16_t i = 0; i < cnt; i++) {
+		len += segs[i].len;
+	}
+
+	if (_ili9341_emu_transfer_start(emu, len)) {
+		for (uint16_t i = 0; i < cnt; i++) {
+			_ili9341_emu_bytes(emu, segs[i].data, segs[i].len);
+		}
+	}
+	return 0;
+}
+
+bool _ili9341_emu_ready(ili9341_emu_ptr_t emu) {
+	emu->stats.hal_calls++;
+	emu->stats.ready_polls++;
+
+	if (emu->cfg.poll_ns == 0) {
+		if (emu->busy_until_ns > emu->now_ns) {
+			_ili9341_emu_advance(emu, emu->busy_until_ns - emu->now_ns);
+		}
+	} else {
+		_ili9341_emu_advance(emu, emu->cfg.poll_ns);
+	}
+
+	if (emu->now_ns >= emu->busy_until_ns) {
+		emu->busy = false;
+	}
+	return !emu->busy;
+}
+
+void _ili9341_emu_gpio(ili9341_emu_ptr_t emu, bool* pin, ili9341_gpio_pin_value_t value, uint32_t* toggles) {
+	emu->stats.hal_calls++;
+	_ili9341_emu_advance(emu, emu->cfg.gpio_ns);
+	if (*pin != (value == ILI9341_PIN_SET)) {
+		*pin = (value == ILI9341_PIN_SET);
+		if (toggles != NULL) {
+			(*toggles)++;
+		}
+	}
+}
+
+void _ili9341_emu_rst(ili9341_emu_ptr_t emu, ili9341_gpio_pin_value_t value) {
+	bool was_set = emu->rst;
+	_ili9341_emu_gpio(emu, &emu->rst, value, NULL);
+	if (!was_set && emu->rst) {
+		_ili9341_emu_hw_reset(emu);
+	}
+}
+
+/*
+ * Pixel the panel shows at the frame memory position, as 8-bit RGB.
+ */
+void _ili9341_emu_panel_pixel(ili9341_emu_ptr_t emu, uint16_t x, uint16_t y, uint8_t* rgb) {
+	if (!emu->display_on || emu->sleep || !emu->rst ||
+			(emu->partial && (emu->partial_sr <= emu->partial_er ?
+					(y < emu->partial_sr || y > emu->partial_er) :
+					(y < emu->partial_sr && y > emu->partial_er)))) {
+		memset(rgb, 0, 3);
+		return;
+	}
+
+	uint16_t line = y;
+	uint16_t tfa = emu->scroll_tfa, vsa = emu->scroll_vsa;
+	if (emu->scrolling && vsa > 0 && y >= tfa && y < tfa + vsa) {
+		line = tfa + (y - tfa + emu->scroll_vsp - tfa + vsa) % vsa;
+	}
+
+	const uint8_t* px = emu->gram[line % ILI9341_EMU_GRAM_HEIGHT][x];
+	bool swap = !(emu->madctl & ILI9341_EMU_MADCTL_BGR);
+	for (int c = 0; c < 3; c++) {
+		uint8_t v = px[swap ? 2 - c : c];
+		if (emu->idle) {
+			v = (v & 0x20) ? 0x3F : 0x00;
+		}
+		if (emu->inverted) {
+			v = 0x3F - v;
+		}
+		rgb[c] = (v << 2) | (v >> 4);
+	}
+}
+
+int _ili9341_emu_dump(ili9341_emu_ptr_t emu, const char* path, bool panel) {
+	FILE* f = fopen(path, "wb");
+	if (f == NULL) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+
+	fprintf(f, "P6\n%d %d\n255\n", ILI9341_EMU_GRAM_WIDTH, ILI9341_EMU_GRAM_HEIGHT);
+	for (uint16_t y = 0; y < ILI9341_EMU_GRAM_HEIGHT; y++) {
+		for (uint16_t x = 0; x < ILI9341_EMU_GRAM_WIDTH; x++) {
+			uint8_t rgb[3];
+			if (panel) {
+				_ili9341_emu_panel_pixel(emu, x, y, rgb);
+			} else {
+				for (int c = 0; c < 3; c++) {
+					rgb[c] = (emu->gram[y][x][c] << 2) | (emu->gram[y][x][c] >> 4);
+				}
+			}
+			fwrite(rgb, 1, sizeof(rgb), f);
+		}
+	}
+
+	return (fclose(f) == 0) ? ILI9341_SUCCESS : -ILI9341_ERR_INV_PARAM;
+}
+
+/* HAL callbacks of each pool slot. */
+#if ILI9341_EMU_MAX_CNT > 3
+#error "Add HAL callbacks for the additional emulators."
+#endif
+
+#define ILI9341_EMU_HAL(n) \
+int _ili9341_emu_tx_##n(const uint8_t* data, uint32_t length) { \
+	return _ili9341_emu_tx(&ili9341_emu_pool.emus[n], data, length); \
+} \
+int _ili9341_emu_tx_repeat_##n(const uint8_t* pattern, uint32_t count) { \
+	return _ili9341_emu_tx_repeat(&ili9341_emu_pool.emus[n], pattern, count); \
+} \
+int _ili9341_emu_tx_sg_##n(const ili9341_seg_t* segs, uint16_t cnt) { \
+	return _ili9341_emu_tx_sg(&ili9341_emu_pool.emus[n], segs, cnt); \
+} \
+bool _ili9341_emu_ready_##n(void) { \
+	return _ili9341_emu_ready(&ili9341_emu_pool.emus[n]); \
+} \
+void _ili9341_emu_rst_##n(ili9341_gpio_pin_value_t value) { \
+	_ili9341_emu_rst(&ili9341_emu_pool.emus[n], value); \
+} \
+void _ili9341_emu_cs_##n(ili9341_gpio_pin_value_t value) { \
+	_ili9341_emu_gpio(&ili9341_emu_pool.emus[n], &ili9341_emu_pool.emus[n].cs, value, \
+			&ili9341_emu_pool.emus[n].stats.cs_toggles); \
+} \
+void _ili9341_emu_dc_##n(ili9341_gpio_pin_value_t value) { \
+	_ili9341_emu_gpio(&ili9341_emu_pool.emus[n], &ili9341_emu_pool.emus[n].dc, value, \
+			&ili9341_emu_pool.emus[n].stats.dc_toggles); \
+} \
+void _ili9341_emu_sleep_##n(uint32_t ms) { \
+	ili9341_emu_advance_ms(&ili9341_emu_pool.emus[n], ms); \
+}
+
+ILI9341_EMU_HAL(0)
+ILI9341_EMU_HAL(1)
+ILI9341_EMU_HAL(2)
+
+#define ILI9341_EMU_HAL_ENTRY(n) { \
+	_ili9341_emu_tx_##n, _ili9341_emu_tx_repeat_##n, _ili9341_emu_tx_sg_##n, _ili9341_emu_ready_##n, \
+	_ili9341_emu_rst_##n, _ili9341_emu_cs_##n, _ili9341_emu_dc_##n, _ili9341_emu_sleep_##n }
+
+static const struct {
+	spi_tx_dma_t spi_tx_dma;
+	spi_tx_repeat_t spi_tx_repeat;
+	spi_tx_dma_sg_t spi_tx_dma_sg;
+	spi_tx_dma_ready_t spi_tx_ready;
+	gpio_rst_pin_t rst_pin;
+	gpio_cs_pin_t cs_pin;
+	gpio_dc_pin_t dc_pin;
+	wait_sleep_t wait_sleep;
+} ili9341_emu_hal[ILI9341_EMU_MAX_CNT] = {
+	ILI9341_EMU_HAL_ENTRY(0),
+	ILI9341_EMU_HAL_ENTRY(1),
+	ILI9341_EMU_HAL_ENTRY(2),
+};
+
+/* Public interface methods. */
+
+ili9341_emu_ptr_t ili9341_emu_create(const ili9341_emu_cfg_t* cfg) {
+	if (ili9341_emu_pool.current_emu >= ILI9341_EMU_MAX_CNT) {
+		return NULL;
+	}
+
+	ili9341_emu_ptr_t emu = &ili9341_emu_pool.emus[ili9341_emu_pool.current_emu++];
+	memset(emu, 0, sizeof(*emu));
+	if (cfg != NULL) {
+		emu->cfg = *cfg;
+	}
+	if (emu->cfg.spi_hz == 0) {
+		emu->cfg.spi_hz = ILI9341_EMU_SPI_HZ;
+	}
+
+	emu->cs = true;
+	emu->rst = true;
+	_ili9341_emu_hw_reset(emu);
+
+	return emu;
+}
+
+void ili9341_emu_get_hal(ili9341_emu_ptr_t emu, ili9341_cfg_t* cfg) {
+	uint8_t n = emu - ili9341_emu_pool.emus;
+
+	cfg->spi_tx_dma = ili9341_emu_hal[n].spi_tx_dma;
+	cfg->spi_tx_ready = ili9341_emu_hal[n].spi_tx_ready;
+	cfg->rst_pin = ili9341_emu_hal[n].rst_pin;
+	cfg->cs_pin = ili9341_emu_hal[n].cs_pin;
+	cfg->dc_pin = ili9341_emu_hal[n].dc_pin;
+	cfg->wait_sleep = ili9341_emu_hal[n].wait_sleep;
+	cfg->spi_tx_repeat = emu->cfg.repeat ? ili9341_emu_hal[n].spi_tx_repeat : NULL;
+	cfg->spi_tx_dma_sg = emu->cfg.sg ? ili9341_emu_hal[n].spi_tx_dma_sg : NULL;
+}
+
+void ili9341_emu_attach(ili9341_emu_ptr_t emu, ili9341_desc_ptr_t desc) {
+	emu->desc = desc;
+}
+
+bool ili9341_emu_irq(ili9341_emu_ptr_t emu) {
+	if (!emu->busy || emu->desc == NULL) {
+		return false;
+	}
+
+	if (emu->busy_until_ns > emu->now_ns) {
+		_ili9341_emu_advance(emu, emu->busy_until_ns - emu->now_ns);
+	}
+	emu->busy = false;
+	ili9341_spi_tx_done_cb(emu->desc);
+
+	return true;
+}
+
+void ili9341_emu_advance_ms(ili9341_emu_ptr_t emu, uint32_t ms) {
+	_ili9341_emu_advance(emu, (uint64_t)ms * 1000000);
+}
+
+void ili9341_emu_advance_ns(ili9341_emu_ptr_t emu, uint32_t ns) {
+	_ili9341_emu_advance(emu, ns);
+}
+
+uint16_t ili9341_emu_read_RGB565(ili9341_emu_ptr_t emu, uint16_t x, uint16_t y) {
+	if (x >= ILI9341_EMU_GRAM_WIDTH || y >= ILI9341_EMU_GRAM_HEIGHT) {
+		return 0;
+	}
+
+	const uint8_t* px = emu->gram[y][x];
+	return ((uint16_t)(px[0] >> 1) << 11) | ((uint16_t)px[1] << 5) | (px[2] >> 1);
+}
+
+uint16_t ili9341_emu_read_screen(ili9341_emu_ptr_t emu, coord_2d_t pos) {
+	uint16_t x, y;
+	_ili9341_emu_map(emu->madctl, pos.x, pos.y, &x, &y);
+	return ili9341_emu_read_RGB565(emu, x, y);
+}
+
+int ili9341_emu_dump_gram(ili9341_emu_ptr_t emu, const char* path) {
+	return _ili9341_emu_dump(emu, path, false);
+}
+
+int ili9341_emu_dump_frame(ili9341_emu_ptr_t emu, const char* path) {
+	return _ili9341_emu_dump(emu, path, true);
+}
+
+ili9341_emu_stats_t ili9341_emu_get_stats(ili9341_emu_ptr_t emu) {
+	ili9341_emu_stats_t stats = emu->stats;
+	stats.time_ns = emu->now_ns - emu->stats_base_ns;
+	return stats;
+}
+
+void ili9341_emu_reset_stats(ili9341_emu_ptr_t emu) {
+	memset(&emu->stats, 0, sizeof(emu->stats));
+	emu->stats_base_ns = emu->now_ns;
+}
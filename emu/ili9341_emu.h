@@ -0,0 +1,177 @@
+/*
+ * ILI9341 controller emulator
+ *
+ * In-process model of the controller behind the driver HAL callbacks, for
+ * running the driver on a host without a board, see README.md.
+ *
+ * Author: Michal Horn
+ */
+
+#ifndef ILI9341_ILI9341_EMU_H_
+#define ILI9341_ILI9341_EMU_H_
+
+#include "ili9341.h"
+
+#define ILI9341_EMU_MAX_CNT (3)	/**< Maximal number of emulators, each one has its own set of HAL callbacks. */
+#define ILI9341_EMU_GRAM_WIDTH (240)	/**< Frame memory columns. */
+#define ILI9341_EMU_GRAM_HEIGHT (320)	/**< Frame memory lines. */
+#define ILI9341_EMU_SPI_HZ (40000000)	/**< Default SPI clock. */
+
+typedef struct ili9341_emu* ili9341_emu_ptr_t;	/**< ILI9341 emulator instance. */
+
+/**
+ * Emulator configuration, zeroed fields take the defaults.
+ */
+typedef struct ili9341_emu_cfg_st {
+	uint32_t spi_hz;	/**< SPI clock in Hz, 0 for ILI9341_EMU_SPI_HZ. */
+	uint32_t xfer_overhead_ns;	/**< Time to start one DMA transfer. */
+	uint32_t gpio_ns;	/**< Time of one GPIO pin write. */
+	uint32_t poll_ns;	/**< Time of one spi_tx_ready poll, 0 to complete a transfer on the first poll. */
+	bool repeat;	/**< Provide spi_tx_repeat. */
+	bool sg;	/**< Provide spi_tx_dma_sg. */
+	bool tick;	/**< Call ili9341_1ms_timer_cb as the simulated time goes. */
+} ili9341_emu_cfg_t;
+
+/**
+ * Emulator statistics.
+ */
+typedef struct ili9341_emu_stats_st {
+	uint64_t time_ns;	/**< Simulated time elapsed. */
+	uint64_t bus_ns;	/**< Time the bus was transferring data. */
+	uint32_t bytes;	/**< Bytes on the wire, command bytes included. */
+	uint32_t commands;	/**< Command bytes. */
+	uint32_t pixels;	/**< Pixels written to the frame memory. */
+	uint32_t transfers;	/**< DMA transfers started by spi_tx_dma, spi_tx_repeat or spi_tx_dma_sg. */
+	uint32_t hal_calls;	/**< Calls of any HAL callback. */
+	uint32_t ready_polls;	/**< spi_tx_ready calls. */
+	uint32_t cs_toggles;	/**< CS pin level changes. */
+	uint32_t dc_toggles;	/**< DC pin level changes. */
+	uint32_t errors;	/**< Protocol violations - data with CS high, transfer started while busy. */
+} ili9341_emu_stats_t;
+
+/**
+ * Create a new emulator.
+ *
+ * The controller starts as after a hardware reset. The simulated time only
+ * advances by bus transfers, GPIO writes, spi_tx_ready polls and
+ * ili9341_emu_advance_ms, so with tick set, the driver timeouts and delays
+ * refer to the simulated time and neither ili9341_1ms_timer_cb nor
+ * ili9341_1ms_tick may be called by anybody else. The time is counted to the
+ * attached driver instance only. A lone emulator counts it to all instances
+ * until attached, with more emulators attach each one right after
+ * ili9341_init_start, before ili9341_init_poll.
+ *
+ * @param [in] cfg Emulator configuration, NULL for the defaults.
+ * @returns emulator instance, NULL when all ILI9341_EMU_MAX_CNT are used.
+ */
+ili9341_emu_ptr_t ili9341_emu_create(const ili9341_emu_cfg_t* cfg);
+
+/**
+ * Fill the HAL callbacks of a driver configuration with the emulator ones.
+ *
+ * Sets spi_tx_dma, spi_tx_ready, rst_pin, cs_pin and dc_pin, spi_tx_repeat
+ * and spi_tx_dma_sg when enabled by the emulator configuration, and
+ * wait_sleep letting the simulated time pass. The other fields are left
+ * untouched, with tick set, choose ILI9341_WAIT_SLEEP in wait_strategy to let
+ * the power ON and tearing effect delays elapse in the simulated time.
+ *
+ * @param [in] emu Emulator.
+ * @param [out] cfg Driver configuration.
+ */
+void ili9341_emu_get_hal(ili9341_emu_ptr_t emu, ili9341_cfg_t* cfg);
+
+/**
+ * Attach the driver instance driven by the emulator, for dma_async mode and
+ * for the tick of the simulated time.
+ *
+ * @param [in] emu Emulator.
+ * @param [in] desc Display driver instance.
+ */
+void ili9341_emu_attach(ili9341_emu_ptr_t emu, ili9341_desc_ptr_t desc);
+
+/**
+ * Complete the transfer in progress and report it by ili9341_spi_tx_done_cb.
+ *
+ * Plays the DMA complete interrupt in dma_async mode, typically from another
+ * thread, as the driver waits without calling the HAL.
+ *
+ * @param [in] emu Emulator with an attached driver instance.
+ * @returns true when a transfer was completed.
+ */
+bool ili9341_emu_irq(ili9341_emu_ptr_t emu);
+
+/**
+ * Let the simulated time pass, for init delays and the tearing effect.
+ *
+ * @param [in] emu Emulator.
+ * @param [in] ms Time in milliseconds.
+ */
+void ili9341_emu_advance_ms(ili9341_emu_ptr_t emu, uint32_t ms);
+
+/**
+ * Let the simulated time pass while the bus keeps transferring, e.g. the
+ * target CPU time of work the host does in no time.
+ *
+ * @param [in] emu Emulator.
+ * @param [in] ns Time in nanoseconds.
+ */
+void ili9341_emu_advance_ns(ili9341_emu_ptr_t emu, uint32_t ns);
+
+/**
+ * Read a pixel of the frame memory.
+ *
+ * @param [in] emu Emulator.
+ * @param [in] x Frame memory column, up to ILI9341_EMU_GRAM_WIDTH.
+ * @param [in] y Frame memory line, up to ILI9341_EMU_GRAM_HEIGHT.
+ * @returns the pixel as RGB565, the least significant bits of RGB666 dropped.
+ */
+uint16_t ili9341_emu_read_RGB565(ili9341_emu_ptr_t emu, uint16_t x, uint16_t y);
+
+/**
+ * Read a pixel of the frame memory at the column and page address the
+ * controller would write it to with the current memory access control.
+ *
+ * @param [in] emu Emulator.
+ * @param [in] pos Screen coordinates in the orientation set by the driver.
+ * @returns the pixel as RGB565.
+ */
+uint16_t ili9341_emu_read_screen(ili9341_emu_ptr_t emu, coord_2d_t pos);
+
+/**
+ * Write the frame memory to a binary PPM file.
+ *
+ * @param [in] emu Emulator.
+ * @param [in] path File path.
+ * @returns ILI9341_SUCCESS or -ILI9341_ERR_INV_PARAM when the file cannot be written.
+ */
+int ili9341_emu_dump_gram(ili9341_emu_ptr_t emu, const char* path);
+
+/**
+ * Write the picture on the panel to a binary PPM file.
+ *
+ * Unlike the frame memory, the picture reflects the display on/off, sleep,
+ * vertical scrolling, partial, idle and inversion modes, and the BGR bit of
+ * MADCTL for a panel with BGR color filters.
+ *
+ * @param [in] emu Emulator.
+ * @param [in] path File path.
+ * @returns ILI9341_SUCCESS or -ILI9341_ERR_INV_PARAM when the file cannot be written.
+ */
+int ili9341_emu_dump_frame(ili9341_emu_ptr_t emu, const char* path);
+
+/**
+ * Get the emulator statistics.
+ *
+ * @param [in] emu Emulator.
+ * @returns statistics since creation or the last reset.
+ */
+ili9341_emu_stats_t ili9341_emu_get_stats(ili9341_emu_ptr_t emu);
+
+/**
+ * Reset the emulator statistics, the simulated time keeps going.
+ *
+ * @param [in] emu Emulator.
+ */
+void ili9341_emu_reset_stats(ili9341_emu_ptr_t emu);
+
+#endif /* ILI9341_ILI9341_EMU_H_ */
@@ -15,6 +15,61 @@
 #include "ili9341.h"
 #include "ili9341_spi_cmds.h"
 #include "string.h"
+#include <stddef.h>
+
+#define ILI9341_STAGE_NONE (-1)	/**< Transaction payload is not in a staging buffer. */
+
+#define ILI9341_BLIT_GATHER_LEN (64)	/**< Rows shorter than this are gathered into staging buffers instead of sent one by one. */
+
+#define ILI9341_SHADOW_MADCTL 0x01	/**< shadow_madctl holds the value last written to the controller. */
+#define ILI9341_SHADOW_CASET 0x02	/**< shadow_caset holds the value last written to the controller. */
+#define ILI9341_SHADOW_PASET 0x04	/**< shadow_paset holds the value last written to the controller. */
+
+#if ILI9341_PERF
+#define ILI9341_PERF_INC(desc, field) ((desc)->perf.field++)
+#define ILI9341_PERF_ADD(desc, field, value) ((desc)->perf.field += (value))
+#define ILI9341_PERF_TXN_BEGIN(desc, txn) _ili9341_perf_txn_begin((desc), (txn))
+#define ILI9341_PERF_TXN_END(desc, txn) _ili9341_perf_txn_end((desc), (txn))
+#else
+#define ILI9341_PERF_INC(desc, field) ((void)0)
+#define ILI9341_PERF_ADD(desc, field, value) ((void)0)
+#define ILI9341_PERF_TXN_BEGIN(desc, txn) ((void)0)
+#define ILI9341_PERF_TXN_END(desc, txn) ((void)0)
+#endif
+
+/**
+ * Source of a strided blit gathered into the staging buffers.
+ */
+typedef struct {
+	const uint8_t* data;
+	uint32_t stride;
+	uint32_t row_len;
+	bool native;	/**< Pixels are uint16_t in the CPU byte order instead of big endian. */
+} ili9341_blit_src_t;
+
+/**
+ * Phase of the transaction currently being transferred.
+ */
+typedef enum {
+	ILI9341_TXN_PHASE_IDLE,
+	ILI9341_TXN_PHASE_CMD,
+	ILI9341_TXN_PHASE_PARAMS,
+	ILI9341_TXN_PHASE_PAYLOAD,
+} ili9341_txn_phase_t;
+
+/**
+ * What a wait loop waits for, see _ili9341_wait_step.
+ */
+typedef enum {
+	ILI9341_WAIT_FOR_DELAY,	/**< Time to pass. */
+	ILI9341_WAIT_FOR_SIGNAL,	/**< Condition set by ili9341_spi_tx_done_cb or ili9341_te_cb. */
+	ILI9341_WAIT_FOR_POLL,	/**< Condition polled by the HAL, the SPI ready flag. */
+} ili9341_wait_for_t;
+
+/**
+ * Condition a wait loop waits for, see _ili9341_wait.
+ */
+typedef bool (*ili9341_wait_cond_t)(const ili9341_desc_ptr_t desc, uint32_t arg);
 
 /**
  * Definition of ili9341 driver instance descriptor.
@@ -29,17 +84,74 @@ struct ili9341_desc {
 	uint16_t current_height;
 	ili9341_orientation_t default_orientation;
 	ili9341_orientation_t current_orientation;
+	uint8_t pixel_size;
 	spi_tx_dma_t spi_tx_dma;
 	spi_tx_dma_ready_t  spi_tx_ready;
+	spi_tx_txn_t spi_tx_txn;
+	spi_tx_repeat_t spi_tx_repeat;
+	spi_tx_dma_sg_t spi_tx_dma_sg;
 	gpio_rst_pin_t rst_pin;
 	gpio_cs_pin_t cs_pin;
 	gpio_dc_pin_t dc_pin;
 	uint32_t timeout_ms;
 	uint32_t restart_delay_ms;
 	uint32_t wup_delay_ms;
-	uint32_t curr_time_cnt;
+	volatile uint32_t curr_time_cnt;
+	volatile uint32_t uptime_ms;
 	coord_2d_t region_top_left;
 	coord_2d_t region_bottom_right;
+	bool dma_async;
+	bool init_done;
+	const ili9341_hw_cfg_t* init_hw_cfg;
+	uint16_t init_pos;
+	uint32_t init_delay_ms;
+	uint8_t shadow_valid;
+	ili9341_madctl_t shadow_madctl;
+	ili9341_caset_t shadow_caset;
+	ili9341_paset_t shadow_paset;
+	bool scroll_on;
+	uint16_t scroll_tfa;
+	uint16_t scroll_vsa;
+	uint16_t scroll_offset;
+	uint16_t region_next_line;
+	uint32_t region_seg_left;
+	bool te_on;
+	uint16_t te_line;
+	volatile uint32_t te_count;
+	volatile uint32_t te_last_ms;
+	volatile uint32_t te_period_ms;
+	irq_lock_t irq_lock;
+	irq_unlock_t irq_unlock;
+	ili9341_wait_strategy_t wait_strategy;
+	wait_yield_t wait_yield;
+	wait_sleep_t wait_sleep;
+	wait_event_t wait_event;
+	wait_signal_t wait_signal;
+	ili9341_txn_t txq[ILI9341_TXQ_LEN];
+	volatile uint8_t txq_head;
+	volatile uint8_t txq_tail;
+	volatile uint8_t txq_cnt;
+	volatile uint8_t txq_phase;
+	volatile uint16_t txq_seg;
+	volatile bool txq_busy;
+	bool txq_defer;
+	volatile int txq_err;
+	volatile uint32_t txq_pushed;
+	volatile uint32_t txq_retired;
+	volatile int8_t txq_stage[ILI9341_TXQ_LEN];
+	volatile uint8_t stage_refs[ILI9341_STAGING_BUF_CNT];
+	uint8_t stage_next;
+	uint8_t stage_buf[ILI9341_STAGING_BUF_CNT][ILI9341_STAGING_BUF_SIZE];
+	volatile uint8_t seg_refs[ILI9341_SEG_TABLE_CNT];
+	uint8_t seg_next;
+	ili9341_seg_t seg_tables[ILI9341_SEG_TABLE_CNT][ILI9341_SEG_TABLE_LEN];
+	ili9341_txn_observer_t txn_observer;
+	void* txn_observer_ctx;
+#if ILI9341_PERF
+	ili9341_perf_t perf;
+	ili9341_trace_cb_t trace_begin;
+	ili9341_trace_cb_t trace_end;
+#endif
 };
 
 /**
@@ -56,136 +168,927 @@ struct ili9341_drivers_pool_st {
 static struct ili9341_drivers_pool_st ili9341_drivers_pool;
 
 
+/**
+ * Default chip configuration, functional on STM32F4-DISCOVERY kit.
+ */
+static const ili9341_hw_cfg_t ili9341_default_hw_cfg = {
+	.pwctrla = {.params = {0x39, 0x2C, 0x00, 0x34, 0x02}},
+	.pwctrlb = {.params = {0x00, 0xC1, 0x30}},
+	.timctrla = {.params = {0x85, 0x00, 0x78}},
+	.timctrlb = {.params = {0xEA, 0x00, 0x00}},
+	.ponseqctrl = {.params = {0x64, 0x03, 0x12, 0x81}},
+	.pumpratctrl = {.params = {0x20}},
+	.pwctr1 = {.params = {0x23}},
+	.pwctr2 = {.params = {0x10}},
+	.vmctr1 = {.params = {0x3E, 0x28}},
+	.vmctr2 = {.params = {0x86}},
+	.madctl = {.params = {0x48}},
+	.pixfmt = {.params = {ILI9341_PIXFMT_16BIT}},
+	.frmctr1 = {.params = {0x00, 0x18}},
+	.dfunctr = {.params = {0x08, 0x82, 0x27}},
+	.g3enable = {.params = {0x00}},
+	.gammaset = {.params = {0x01}},
+	.gmctrp1 = {.params = {0x0F, 0x31, 0x2B, 0x0C, 0x0E, 0x08, 0x4E, 0xF1, 0x37, 0x07, 0x10, 0x03, 0x0E, 0x09, 0x00}},
+	.gmctrn1 = {.params = {0x00, 0x0E, 0x14, 0x03, 0x11, 0x07, 0x31, 0xC1, 0x48, 0x08, 0x0F, 0x0C, 0x31, 0x36, 0x0F}},
+};
+
+#define ILI9341_INIT_STEP_LEN 3	/**< Bytes per init sequence step: command, length, hw_cfg offset. */
+#define ILI9341_INIT_DELAY 0xFF	/**< Length marker of a delay step, the offset byte selects the delay. */
+#define ILI9341_INIT_DELAY_RESTART 0	/**< Delay step waiting for restart_delay_ms. */
+#define ILI9341_INIT_DELAY_WAKEUP 1	/**< Delay step waiting for wup_delay_ms. */
+
+/** Command without parameters. */
+#define ILI9341_INIT_CMD(cmd) (cmd), 0, 0
+/** Command with parameters taken from the given ili9341_hw_cfg_t field. */
+#define ILI9341_INIT_CFG(cmd, field) (cmd), sizeof(((ili9341_hw_cfg_t*)0)->field), offsetof(ili9341_hw_cfg_t, field)
+/** Wait for all previous commands to be sent and the given delay. */
+#define ILI9341_INIT_WAIT(delay) ILI9341_CMD_NOP, ILI9341_INIT_DELAY, (delay)
+
+/**
+ * Power ON sequence. Built at compile time, the parameters are looked up in
+ * the ili9341_hw_cfg_t passed to ili9341_init.
+ */
+static const uint8_t ili9341_init_seq[] = {
+	ILI9341_INIT_CMD(ILI9341_CMD_SWRESET),
+	ILI9341_INIT_WAIT(ILI9341_INIT_DELAY_RESTART),
+	ILI9341_INIT_CFG(ILI9341_CMD_PWCTRLA, pwctrla),
+	ILI9341_INIT_CFG(ILI9341_CMD_PWCTRLB, pwctrlb),
+	ILI9341_INIT_CFG(ILI9341_CMD_TIMCTRLA, timctrla),
+	ILI9341_INIT_CFG(ILI9341_CMD_TIMCTRLB, timctrlb),
+	ILI9341_INIT_CFG(ILI9341_CMD_PONSEQCTRL, ponseqctrl),
+	ILI9341_INIT_CFG(ILI9341_CMD_PUMPRATCTRL, pumpratctrl),
+	ILI9341_INIT_CFG(ILI9341_CMD_PWCTR1, pwctr1),
+	ILI9341_INIT_CFG(ILI9341_CMD_PWCTR2, pwctr2),
+	ILI9341_INIT_CFG(ILI9341_CMD_VMCTR1, vmctr1),
+	ILI9341_INIT_CFG(ILI9341_CMD_VMCTR2, vmctr2),
+	ILI9341_INIT_CFG(ILI9341_CMD_MADCTL, madctl),
+	ILI9341_INIT_CFG(ILI9341_CMD_PIXFMT, pixfmt),
+	ILI9341_INIT_CFG(ILI9341_CMD_FRMCTR1, frmctr1),
+	ILI9341_INIT_CFG(ILI9341_CMD_DFUNCTR, dfunctr),
+	ILI9341_INIT_CFG(ILI9341_CMD_3GENABLE, g3enable),
+	ILI9341_INIT_CFG(ILI9341_CMD_GAMMASET, gammaset),
+	ILI9341_INIT_CFG(ILI9341_CMD_GMCTRP1, gmctrp1),
+	ILI9341_INIT_CFG(ILI9341_CMD_GMCTRN1, gmctrn1),
+	ILI9341_INIT_CMD(ILI9341_CMD_SLPOUT),
+	ILI9341_INIT_WAIT(ILI9341_INIT_DELAY_WAKEUP),
+	ILI9341_INIT_CMD(ILI9341_CMD_DISPON),
+};
+
 /* Private methods. */
 void _ili9341_enable(const ili9341_desc_ptr_t desc);
-int _ili9341_write_cmd(const ili9341_desc_ptr_t desc, ili9341_cmd_t command);
-int _ili9341_write_bytes(const ili9341_desc_ptr_t desc, const uint8_t* bytes, uint32_t len);
-void _ili9341_write_bytes_start(const ili9341_desc_ptr_t desc);
-void _ili9341_write_bytes_end(const ili9341_desc_ptr_t desc);
-int _ili9341_write_data(const ili9341_desc_ptr_t desc, const uint8_t* buffer, uint32_t size);
+int _ili9341_init_step(const ili9341_desc_ptr_t desc);
+bool _ili9341_is_async(const ili9341_desc_ptr_t desc);
+int _ili9341_send(const ili9341_desc_ptr_t desc, uint8_t cmd, const uint8_t* params, uint8_t params_len);
+int _ili9341_send_payload(const ili9341_desc_ptr_t desc, const uint8_t* payload, uint32_t len);
+int _ili9341_send_shadowed(const ili9341_desc_ptr_t desc, uint8_t cmd, const uint8_t* params, uint8_t* shadow, uint8_t params_len, uint8_t shadow_flag);
+int _ili9341_txq_push(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn, int8_t stage);
+int _ili9341_push_payload(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn, int8_t stage);
+bool _ili9341_rows_swapped(const ili9341_desc_ptr_t desc);
+bool _ili9341_rows_flipped(const ili9341_desc_ptr_t desc);
+uint16_t _ili9341_scroll_map(const ili9341_desc_ptr_t desc, uint16_t line);
+uint16_t _ili9341_scroll_run(const ili9341_desc_ptr_t desc, uint16_t first, uint16_t last);
+int _ili9341_region_segment(const ili9341_desc_ptr_t desc, uint16_t first);
+void _ili9341_panel_lines(const ili9341_desc_ptr_t desc, coord_2d_t top_left, coord_2d_t bottom_right, uint16_t* first, uint16_t* last);
+uint8_t* _ili9341_stream_acquire(const ili9341_desc_ptr_t desc, int8_t* stage);
+int _ili9341_stream_commit(const ili9341_desc_ptr_t desc, int8_t stage, uint32_t len);
+int _ili9341_stream_commit_repeat(const ili9341_desc_ptr_t desc, int8_t stage, uint32_t len);
+int _ili9341_stream(const ili9341_desc_ptr_t desc, uint32_t size, ili9341_stream_producer_t producer, void* ctx);
+void _ili9341_swap_pixels(void* ctx, uint8_t* buf, uint32_t offset, uint32_t len);
+void _ili9341_gather_rows(void* ctx, uint8_t* buf, uint32_t offset, uint32_t len);
+void _ili9341_expand_rows(void* ctx, uint8_t* buf, uint32_t offset, uint32_t len);
+void _ili9341_RGB565_to_RGB666(uint16_t color, uint8_t* out);
+bool _ili9341_seg_enabled(const ili9341_desc_ptr_t desc);
+ili9341_seg_t* _ili9341_seg_acquire(const ili9341_desc_ptr_t desc, int8_t* table);
+int _ili9341_seg_commit(const ili9341_desc_ptr_t desc, int8_t table, uint16_t cnt, int8_t stage);
+void _ili9341_seg_ref(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn, int8_t delta);
+int _ili9341_txq_advance(const ili9341_desc_ptr_t desc);
+int _ili9341_txn_step_phased(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn);
+int _ili9341_txn_step_hal(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn);
+void _ili9341_txq_retire(const ili9341_desc_ptr_t desc);
+int _ili9341_txq_sync(const ili9341_desc_ptr_t desc);
+void _ili9341_txq_abort(const ili9341_desc_ptr_t desc);
+void _ili9341_lock(const ili9341_desc_ptr_t desc);
+void _ili9341_unlock(const ili9341_desc_ptr_t desc);
 int _ili9341_wait_for_spi_ready(const ili9341_desc_ptr_t desc);
-void _ili9341_delay_ms(const ili9341_desc_ptr_t desc, uint32_t time_ms);
+int _ili9341_wait(const ili9341_desc_ptr_t desc, ili9341_wait_for_t what, ili9341_wait_cond_t cond, uint32_t arg);
+void _ili9341_wait_step(const ili9341_desc_ptr_t desc, ili9341_wait_for_t what, uint32_t left_ms);
+bool _ili9341_is_spi_ready(const ili9341_desc_ptr_t desc, uint32_t arg);
+bool _ili9341_is_stage_free(const ili9341_desc_ptr_t desc, uint32_t stage);
+bool _ili9341_is_seg_free(const ili9341_desc_ptr_t desc, uint32_t table);
+bool _ili9341_is_txq_free(const ili9341_desc_ptr_t desc, uint32_t arg);
+bool _ili9341_is_txq_idle(const ili9341_desc_ptr_t desc, uint32_t arg);
+bool _ili9341_is_fence_done(const ili9341_desc_ptr_t desc, uint32_t fence);
+bool _ili9341_is_te_measured(const ili9341_desc_ptr_t desc, uint32_t count);
+#if ILI9341_PERF
+void _ili9341_perf_txn_begin(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn);
+void _ili9341_perf_txn_end(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn);
+#endif
 
-int _ili9341_init_display(const ili9341_desc_ptr_t desc, const ili9341_hw_cfg_t* hw_cfg) {
+/*
+ * Run the init sequence until the next delay or its end. Commands are sent
+ * synchronously, delays are left to elapse between the calls.
+ */
+int _ili9341_init_step(const ili9341_desc_ptr_t desc) {
 	int err = ILI9341_SUCCESS;
-	_ili9341_enable(desc);
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_SWRESET);
-	_ili9341_delay_ms(desc, desc->restart_delay_ms);
-
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_PWCTRLA);
-	err |= _ili9341_write_data(desc, hw_cfg->pwctrla.params, sizeof(hw_cfg->pwctrla));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_PWCTRLB);
-	err |= _ili9341_write_data(desc, hw_cfg->pwctrlb.params, sizeof(hw_cfg->pwctrlb));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_TIMCTRLA);
-	err |= _ili9341_write_data(desc, hw_cfg->timctrla.params, sizeof(hw_cfg->timctrla));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_TIMCTRLB);
-	err |= _ili9341_write_data(desc, hw_cfg->timctrlb.params, sizeof(hw_cfg->timctrlb));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_PONSEQCTRL);
-	err |= _ili9341_write_data(desc, hw_cfg->ponseqctrl.params, sizeof(hw_cfg->ponseqctrl));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_PUMPRATCTRL);
-	err |= _ili9341_write_data(desc, hw_cfg->pumpratctrl.params, sizeof(hw_cfg->pumpratctrl));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_PWCTR1);
-	err |= _ili9341_write_data(desc, hw_cfg->pwctr1.params, sizeof(hw_cfg->pwctr1));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_PWCTR2);
-	err |= _ili9341_write_data(desc, hw_cfg->pwctr2.params, sizeof(hw_cfg->pwctr2));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_VMCTR1);
-	err |= _ili9341_write_data(desc, hw_cfg->vmctr1.params, sizeof(hw_cfg->vmctr1));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_VMCTR2);
-	err |= _ili9341_write_data(desc, hw_cfg->vmctr2.params, sizeof(hw_cfg->vmctr2));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_MADCTL);
-	err |= _ili9341_write_data(desc, hw_cfg->madctl.params, sizeof(hw_cfg->madctl));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_PIXFMT);
-	err |= _ili9341_write_data(desc, hw_cfg->pixfmt.params, sizeof(hw_cfg->pixfmt));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_FRMCTR1);
-	err |= _ili9341_write_data(desc, hw_cfg->frmctr1.params, sizeof(hw_cfg->frmctr1));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_DFUNCTR);
-	err |= _ili9341_write_data(desc, hw_cfg->dfunctr.params, sizeof(hw_cfg->dfunctr));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_3GENABLE);
-	err |= _ili9341_write_data(desc, hw_cfg->g3enable.params, sizeof(hw_cfg->g3enable));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_GAMMASET);
-	err |= _ili9341_write_data(desc, hw_cfg->gammaset.params, sizeof(hw_cfg->gammaset));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_GMCTRP1);
-	err |= _ili9341_write_data(desc, hw_cfg->gmctrp1.params, sizeof(hw_cfg->gmctrp1));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_GMCTRN1);
-	err |= _ili9341_write_data(desc, hw_cfg->gmctrn1.params, sizeof(hw_cfg->gmctrn1));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_SLPOUT);
-	_ili9341_delay_ms(desc, desc->wup_delay_ms);
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_DISPON);
+	const uint8_t* cfg_bytes = (const uint8_t*)desc->init_hw_cfg;
+
+	if (desc->init_delay_ms > 0) {
+		if (desc->curr_time_cnt < desc->init_delay_ms) {
+			return err;
+		}
+		desc->init_delay_ms = 0;
+	}
+
+	while ((uint32_t)desc->init_pos + ILI9341_INIT_STEP_LEN <= sizeof(ili9341_init_seq)) {
+		const uint8_t* step = &ili9341_init_seq[desc->init_pos];
+		uint8_t cmd = step[0];
+		uint8_t params_len = step[1];
+		uint8_t arg = step[2];
+		desc->init_pos += ILI9341_INIT_STEP_LEN;
+
+		if (params_len == ILI9341_INIT_DELAY) {
+			desc->init_delay_ms = (arg == ILI9341_INIT_DELAY_RESTART) ? desc->restart_delay_ms : desc->wup_delay_ms;
+			desc->curr_time_cnt = 0;
+			if (desc->init_delay_ms > 0) {
+				return err;
+			}
+			continue;
+		}
+
+		err |= _ili9341_send(desc, cmd, &cfg_bytes[arg], params_len);
+		if (err < 0) {
+			return err;
+		}
+	}
+
 	err |= ili9341_set_orientation(desc, desc->default_orientation);
 	coord_2d_t top_left = {.x = 0, .y = 0};
 	coord_2d_t bottom_right = {.x = desc->current_width, .y = desc->current_height};
 	err |= ili9341_set_region(desc, top_left, bottom_right);
+	if (err == ILI9341_SUCCESS) {
+		desc->init_done = true;
+	}
 
 	return err;
 }
 
+/*
+ * The queue is drained synchronously until init is done, DMA complete
+ * notifications coming meanwhile are ignored by ili9341_spi_tx_done_cb.
+ */
+bool _ili9341_is_async(const ili9341_desc_ptr_t desc) {
+	return desc->dma_async && desc->init_done;
+}
+
 void _ili9341_enable(const ili9341_desc_ptr_t desc) {
 	desc->rst_pin(ILI9341_PIN_SET);
 }
 
-int _ili9341_write_cmd(const ili9341_desc_ptr_t desc, ili9341_cmd_t command) {
+int _ili9341_send(const ili9341_desc_ptr_t desc, uint8_t cmd, const uint8_t* params, uint8_t params_len) {
+	if (params_len > ILI9341_TXN_MAX_PARAMS) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+
+	ili9341_txn_t txn;
+	txn.cmd = cmd;
+	txn.flags = 0;
+	txn.params_len = params_len;
+	if (params_len > 0) {
+		memcpy(txn.params, params, params_len);
+	}
+	txn.payload = NULL;
+	txn.payload_len = 0;
+
+	return _ili9341_txq_push(desc, &txn, ILI9341_STAGE_NONE);
+}
+
+/*
+ * Send the register write only when it differs from the last value written,
+ * kept in the shadow copy in the descriptor. The shadow is updated under the
+ * lock before the write is queued, so _ili9341_txq_abort clearing it from the
+ * interrupt once the write is queued is never overwritten.
+ */
+int _ili9341_send_shadowed(const ili9341_desc_ptr_t desc, uint8_t cmd, const uint8_t* params, uint8_t* shadow, uint8_t params_len, uint8_t shadow_flag) {
+	if ((desc->shadow_valid & shadow_flag) && memcmp(shadow, params, params_len) == 0) {
+		return ILI9341_SUCCESS;
+	}
+
+	_ili9341_lock(desc);
+	memcpy(shadow, params, params_len);
+	desc->shadow_valid |= shadow_flag;
+	_ili9341_unlock(desc);
+
+	int err = _ili9341_send(desc, cmd, params, params_len);
+	if (err < 0) {
+		_ili9341_lock(desc);
+		desc->shadow_valid &= ~shadow_flag;
+		_ili9341_unlock(desc);
+	}
+
+	return err;
+}
+
+int _ili9341_send_payload(const ili9341_desc_ptr_t desc, const uint8_t* payload, uint32_t len) {
+	ili9341_txn_t txn;
+	txn.cmd = ILI9341_CMD_NOP;
+	txn.flags = ILI9341_TXN_FLAG_NO_CMD;
+	txn.params_len = 0;
+	txn.payload = payload;
+	txn.payload_len = len;
+
+	return _ili9341_push_payload(desc, &txn, ILI9341_STAGE_NONE);
+}
+
+/*
+ * Queue payload data of the current region. When the region is split into
+ * several windows by the scrolling area wrap, the payload is split as well and
+ * the next window is set up in between.
+ */
+int _ili9341_push_payload(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn, int8_t stage) {
 	int err = ILI9341_SUCCESS;
+	ili9341_txn_t part = *txn;
 
-	desc->dc_pin(ILI9341_PIN_RESET);
-	desc->cs_pin(ILI9341_PIN_RESET);
-	err |= _ili9341_wait_for_spi_ready(desc);
-	err |= desc->spi_tx_dma(&command, ILI9341_CMD_LEN);
-	err |= _ili9341_wait_for_spi_ready(desc);
-	desc->cs_pin(ILI9341_PIN_SET);
+	while (part.payload_len > desc->region_seg_left) {
+		uint32_t rest = part.payload_len - desc->region_seg_left;
+		part.payload_len = desc->region_seg_left;
+		err |= _ili9341_txq_push(desc, &part, stage);
+
+		if (!(part.flags & ILI9341_TXN_FLAG_REPEAT)) {
+			part.payload += part.payload_len;
+		}
+		part.payload_len = rest;
+		err |= _ili9341_region_segment(desc, desc->region_next_line);
+		if (err < 0) {
+			return err;
+		}
+	}
+
+	desc->region_seg_left -= part.payload_len;
+	err |= _ili9341_txq_push(desc, &part, stage);
+
+	return err;
+}
+
+/*
+ * Get the next staging buffer, waiting until queued transactions release it.
+ * In the synchronous mode nobody else retires them, the queue is drained.
+ */
+uint8_t* _ili9341_stream_acquire(const ili9341_desc_ptr_t desc, int8_t* stage) {
+	int8_t idx = desc->stage_next;
+
+	if (desc->stage_refs[idx] > 0 && !_ili9341_is_async(desc) && _ili9341_txq_sync(desc) < 0) {
+		return NULL;
+	}
+	if (_ili9341_wait(desc, ILI9341_WAIT_FOR_SIGNAL, _ili9341_is_stage_free, idx) < 0) {
+		return NULL;
+	}
+
+	desc->stage_next = (desc->stage_next + 1) % ILI9341_STAGING_BUF_CNT;
+	*stage = idx;
+	return desc->stage_buf[idx];
+}
+
+/*
+ * Queue len bytes of the staging buffer as payload. The same buffer can be
+ * committed several times, it is released after the last use is sent.
+ */
+int _ili9341_stream_commit(const ili9341_desc_ptr_t desc, int8_t stage, uint32_t len) {
+	ili9341_txn_t txn;
+	txn.cmd = ILI9341_CMD_NOP;
+	txn.flags = ILI9341_TXN_FLAG_NO_CMD;
+	txn.params_len = 0;
+	txn.payload = desc->stage_buf[stage];
+	txn.payload_len = len;
+
+	return _ili9341_push_payload(desc, &txn, stage);
+}
+
+/*
+ * Queue len bytes made of the pattern in the first ILI9341_REPEAT_PATTERN_LEN
+ * bytes of the staging buffer repeated, sent by the spi_tx_repeat handler.
+ */
+int _ili9341_stream_commit_repeat(const ili9341_desc_ptr_t desc, int8_t stage, uint32_t len) {
+	ili9341_txn_t txn;
+	txn.cmd = ILI9341_CMD_NOP;
+	txn.flags = ILI9341_TXN_FLAG_NO_CMD | ILI9341_TXN_FLAG_REPEAT;
+	txn.params_len = 0;
+	txn.payload = desc->stage_buf[stage];
+	txn.payload_len = len;
+
+	return _ili9341_push_payload(desc, &txn, stage);
+}
+
+/*
+ * Stream size bytes of payload generated chunk by chunk into the staging
+ * buffers. The next chunk is produced while the previous one is in flight.
+ * In the synchronous mode the chunk is left in flight too, the previous one is
+ * waited for after the next one is produced and the last one before return.
+ */
+int _ili9341_stream(const ili9341_desc_ptr_t desc, uint32_t size, ili9341_stream_producer_t producer, void* ctx) {
+	int err = ILI9341_SUCCESS;
+	uint32_t offset = 0;
+	bool sync = !_ili9341_is_async(desc);
+
+	desc->txq_defer = sync;
+	while (offset < size) {
+		int8_t stage;
+		uint8_t* buf = _ili9341_stream_acquire(desc, &stage);
+		if (buf == NULL) {
+			err = -ILI9341_ERR_COMM_TIMEOUT;
+			break;
+		}
+
+		/* Chunks hold whole pixels. */
+		uint32_t len = size - offset;
+		if (len > ILI9341_STAGING_BUF_SIZE) {
+			len = ILI9341_STAGING_BUF_SIZE - ILI9341_STAGING_BUF_SIZE % desc->pixel_size;
+		}
+		producer(ctx, buf, offset, len);
+		if (sync) {
+			err |= _ili9341_txq_sync(desc);
+		}
+		if (err == ILI9341_SUCCESS) {
+			err |= _ili9341_stream_commit(desc, stage, len);
+		}
+		if (err < 0) {
+			break;
+		}
+		offset += len;
+	}
+	desc->txq_defer = false;
+
+	if (sync && err == ILI9341_SUCCESS) {
+		err = _ili9341_txq_sync(desc);
+	}
 
 	return err;
 }
 
-int _ili9341_write_bytes(const ili9341_desc_ptr_t desc, const uint8_t* bytes, uint32_t size) {
+/*
+ * Segment lists are used when the platform sends them without help or
+ * when the driver does it. A spi_tx_txn handler is not required to know them.
+ */
+bool _ili9341_seg_enabled(const ili9341_desc_ptr_t desc) {
+	return desc->spi_tx_txn == NULL || desc->spi_tx_dma_sg != NULL;
+}
+
+/*
+ * Get the next segment table, waiting until queued transactions release it.
+ * In the synchronous mode nobody else retires them, the queue is drained.
+ */
+ili9341_seg_t* _ili9341_seg_acquire(const ili9341_desc_ptr_t desc, int8_t* table) {
+	int8_t idx = desc->seg_next;
+
+	if (desc->seg_refs[idx] > 0 && !_ili9341_is_async(desc) && _ili9341_txq_sync(desc) < 0) {
+		return NULL;
+	}
+	if (_ili9341_wait(desc, ILI9341_WAIT_FOR_SIGNAL, _ili9341_is_seg_free, idx) < 0) {
+		return NULL;
+	}
+
+	desc->seg_next = (desc->seg_next + 1) % ILI9341_SEG_TABLE_CNT;
+	*table = idx;
+	return desc->seg_tables[idx];
+}
+
+/*
+ * Queue the first cnt segments of the table as one payload transaction. The
+ * segments may point to the staging buffer stage, which is held until sent.
+ */
+int _ili9341_seg_commit(const ili9341_desc_ptr_t desc, int8_t table, uint16_t cnt, int8_t stage) {
+	int err = ILI9341_SUCCESS;
+	const ili9341_seg_t* segs = desc->seg_tables[table];
+	uint32_t total = 0;
+
+	for (uint16_t i = 0; i < cnt; i++) {
+		total += segs[i].len;
+	}
+
+	/* Splitting a segment list at a scrolling wrap is not worth it, send one by one. */
+	if (total > desc->region_seg_left) {
+		for (uint16_t i = 0; i < cnt; i++) {
+			ili9341_txn_t txn;
+			txn.cmd = ILI9341_CMD_NOP;
+			txn.flags = ILI9341_TXN_FLAG_NO_CMD;
+			txn.params_len = 0;
+			txn.payload = segs[i].data;
+			txn.payload_len = segs[i].len;
+			err |= _ili9341_push_payload(desc, &txn, stage);
+			if (err < 0) {
+				return err;
+			}
+		}
+		return err;
+	}
+
+	ili9341_txn_t txn;
+	txn.cmd = ILI9341_CMD_NOP;
+	txn.flags = ILI9341_TXN_FLAG_NO_CMD | ILI9341_TXN_FLAG_SEGMENTS;
+	txn.params_len = 0;
+	txn.payload = NULL;
+	txn.payload_len = total;
+	txn.segs = segs;
+	txn.seg_cnt = cnt;
+
+	desc->region_seg_left -= total;
+	return _ili9341_txq_push(desc, &txn, stage);
+}
+
+/*
+ * Hold or release the segment table of a queued transaction.
+ */
+void _ili9341_seg_ref(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn, int8_t delta) {
+	if (txn->flags & ILI9341_TXN_FLAG_SEGMENTS) {
+		uint32_t table = (uint32_t)(txn->segs - desc->seg_tables[0]) / ILI9341_SEG_TABLE_LEN;
+		desc->seg_refs[table] += delta;
+	}
+}
+
+/*
+ * Stream producer converting native uint16_t pixels to the big endian bus
+ * order. Two pixels are swapped at once in a 32-bit word, the loop is simple
+ * enough for the compiler to vectorize it further.
+ */
+void _ili9341_swap_pixels(void* ctx, uint8_t* buf, uint32_t offset, uint32_t len) {
+	const uint8_t* src = (const uint8_t*)ctx + offset;
+	uint32_t i = 0;
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	memcpy(buf, src, len);
+	i = len;
+#else
+	for (; i + 4 <= len; i += 4) {
+		uint32_t word;
+		memcpy(&word, src + i, sizeof(word));
+		word = ((word & 0x00FF00FFu) << 8) | ((word >> 8) & 0x00FF00FFu);
+		memcpy(buf + i, &word, sizeof(word));
+	}
+#endif
+
+	for (; i < len; i += 2) {
+		buf[i] = src[i + 1];
+		buf[i + 1] = src[i];
+	}
+}
+
+/*
+ * Stream producer copying rows of a strided source one after another.
+ */
+void _ili9341_gather_rows(void* ctx, uint8_t* buf, uint32_t offset, uint32_t len) {
+	const ili9341_blit_src_t* src = (const ili9341_blit_src_t*)ctx;
+	uint32_t row = offset / src->row_len;
+	uint32_t col = offset % src->row_len;
+
+	while (len > 0) {
+		uint32_t chunk = src->row_len - col;
+		if (chunk > len) {
+			chunk = len;
+		}
+		memcpy(buf, src->data + row * src->stride + col, chunk);
+		buf += chunk;
+		len -= chunk;
+		col = 0;
+		row++;
+	}
+}
+
+/*
+ * Expand RGB565 color to the 3 bytes of RGB666 pixel, each channel in the
+ * upper 6 bits. 5-bit channels repeat their top bits to reach full scale.
+ */
+void _ili9341_RGB565_to_RGB666(uint16_t color, uint8_t* out) {
+	uint8_t r = (color >> 11) & 0x1F;
+	uint8_t g = (color >> 5) & 0x3F;
+	uint8_t b = color & 0x1F;
+	out[0] = ((r << 3) | (r >> 2)) & 0xFC;
+	out[1] = g << 2;
+	out[2] = ((b << 3) | (b >> 2)) & 0xFC;
+}
+
+/*
+ * Stream producer converting rows of a strided RGB565 source to RGB666.
+ */
+void _ili9341_expand_rows(void* ctx, uint8_t* buf, uint32_t offset, uint32_t len) {
+	const ili9341_blit_src_t* src = (const ili9341_blit_src_t*)ctx;
+	uint32_t row_px = src->row_len / 2;
+	uint32_t pixel = offset / 3;
+	uint32_t cnt = len / 3;
+	uint32_t row = pixel / row_px;
+	uint32_t col = pixel % row_px;
+
+	while (cnt > 0) {
+		uint32_t run = row_px - col;
+		if (run > cnt) {
+			run = cnt;
+		}
+
+		const uint8_t* in = src->data + row * src->stride + col * 2;
+		for (uint32_t i = 0; i < run; i++, in += 2, buf += 3) {
+			uint16_t color;
+			if (src->native) {
+				memcpy(&color, in, sizeof(color));
+			} else {
+				color = (in[0] << 8) | in[1];
+			}
+			_ili9341_RGB565_to_RGB666(color, buf);
+		}
+		cnt -= run;
+		col = 0;
+		row++;
+	}
+}
+
+int _ili9341_txq_push(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn, int8_t stage) {
 	int err = ILI9341_SUCCESS;
 
-	err |= _ili9341_wait_for_spi_ready(desc);
-	err |= desc->spi_tx_dma(bytes, size);
-	err |= _ili9341_wait_for_spi_ready(desc);
+	/* Queue full of deferred transactions, drain it. */
+	if (!_ili9341_is_async(desc) && desc->txq_cnt >= ILI9341_TXQ_LEN) {
+		err = _ili9341_txq_sync(desc);
+		if (err < 0) {
+			return err;
+		}
+	}
+
+	/* Queue full, wait for the DMA complete notification to retire the head. */
+	err = _ili9341_wait(desc, ILI9341_WAIT_FOR_SIGNAL, _ili9341_is_txq_free, 0);
+	if (err < 0) {
+		return err;
+	}
+
+	if (desc->txn_observer != NULL) {
+		desc->txn_observer(desc->txn_observer_ctx, txn);
+	}
+
+	_ili9341_lock(desc);
+	desc->txq[desc->txq_tail] = *txn;
+	desc->txq_stage[desc->txq_tail] = stage;
+	if (stage != ILI9341_STAGE_NONE) {
+		desc->stage_refs[stage]++;
+	}
+	_ili9341_seg_ref(desc, txn, 1);
+	desc->txq_tail = (desc->txq_tail + 1) % ILI9341_TXQ_LEN;
+	desc->txq_cnt++;
+	desc->txq_pushed++;
+	if (!desc->txq_busy) {
+		err = _ili9341_txq_advance(desc);
+	}
+	_ili9341_unlock(desc);
+
+	if (err == ILI9341_SUCCESS && !_ili9341_is_async(desc) && !desc->txq_defer) {
+		err = _ili9341_txq_sync(desc);
+	}
 
 	return err;
 }
 
-void _ili9341_write_bytes_start(const ili9341_desc_ptr_t desc) {
-	desc->dc_pin(ILI9341_PIN_SET);
-	desc->cs_pin(ILI9341_PIN_RESET);
+/*
+ * Start the next transfer of the transaction at the queue head. Finished
+ * transactions are retired and the next one is started, until a DMA is
+ * running or the queue is empty.
+ */
+int _ili9341_txq_advance(const ili9341_desc_ptr_t desc) {
+	while (desc->txq_cnt > 0) {
+		const ili9341_txn_t* txn = &desc->txq[desc->txq_head];
+		int started;
+
+		ILI9341_PERF_TXN_BEGIN(desc, txn);
+
+		if (desc->spi_tx_txn != NULL) {
+			started = _ili9341_txn_step_hal(desc, txn);
+		} else {
+			started = _ili9341_txn_step_phased(desc, txn);
+		}
+
+		if (started < 0) {
+			_ili9341_txq_abort(desc);
+			desc->txq_err = started;
+			return started;
+		}
+		if (started) {
+			return ILI9341_SUCCESS;
+		}
+
+		_ili9341_txq_retire(desc);
+	}
+
+	desc->txq_busy = false;
+	return ILI9341_SUCCESS;
 }
 
-void _ili9341_write_bytes_end(const ili9341_desc_ptr_t desc) {
+/*
+ * Adapter of the transaction to the spi_tx_dma, cs_pin and dc_pin handlers.
+ * Sends the next non-empty phase (command, parameters, payload) of the
+ * transaction. Returns 1 when a transfer was started, 0 when the transaction
+ * is complete or negative error code.
+ */
+int _ili9341_txn_step_phased(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn) {
+	while (desc->txq_phase != ILI9341_TXN_PHASE_PAYLOAD) {
+		const uint8_t* data = NULL;
+		uint32_t len = 0;
+
+		switch (desc->txq_phase) {
+		case ILI9341_TXN_PHASE_IDLE:
+			desc->txq_phase = ILI9341_TXN_PHASE_CMD;
+			if (!(txn->flags & ILI9341_TXN_FLAG_NO_CMD)) {
+				desc->dc_pin(ILI9341_PIN_RESET);
+				desc->cs_pin(ILI9341_PIN_RESET);
+				data = &txn->cmd;
+				len = ILI9341_CMD_LEN;
+			}
+			break;
+		case ILI9341_TXN_PHASE_CMD:
+			desc->txq_phase = ILI9341_TXN_PHASE_PARAMS;
+			data = txn->params;
+			len = txn->params_len;
+			break;
+		default:
+			desc->txq_phase = ILI9341_TXN_PHASE_PAYLOAD;
+			data = txn->payload;
+			len = txn->payload_len;
+			break;
+		}
+
+		if (len == 0) {
+			continue;
+		}
+
+		if (desc->txq_phase != ILI9341_TXN_PHASE_CMD) {
+			desc->dc_pin(ILI9341_PIN_SET);
+			desc->cs_pin(ILI9341_PIN_RESET);
+		}
+
+		desc->txq_busy = true;
+		int err;
+		if (desc->txq_phase == ILI9341_TXN_PHASE_PAYLOAD && (txn->flags & ILI9341_TXN_FLAG_REPEAT)) {
+			err = desc->spi_tx_repeat(data, len / ILI9341_REPEAT_PATTERN_LEN);
+		} else if (desc->txq_phase == ILI9341_TXN_PHASE_PAYLOAD && (txn->flags & ILI9341_TXN_FLAG_SEGMENTS)) {
+			if (desc->spi_tx_dma_sg != NULL) {
+				desc->txq_seg = txn->seg_cnt;
+				err = desc->spi_tx_dma_sg(txn->segs, txn->seg_cnt);
+			} else {
+				desc->txq_seg = 1;
+				err = desc->spi_tx_dma(txn->segs[0].data, txn->segs[0].len);
+			}
+		} else {
+			err = desc->spi_tx_dma(data, len);
+		}
+		return (err < 0) ? err : 1;
+	}
+
+	/* Without scatter-gather DMA, the segments are sent one per transfer. */
+	if ((txn->flags & ILI9341_TXN_FLAG_SEGMENTS) && desc->txq_seg < txn->seg_cnt) {
+		const ili9341_seg_t* seg = &txn->segs[desc->txq_seg++];
+		int err = desc->spi_tx_dma(seg->data, seg->len);
+		return (err < 0) ? err : 1;
+	}
+
 	desc->cs_pin(ILI9341_PIN_SET);
+	return 0;
+}
+
+/*
+ * The whole transaction is passed to the platform at once.
+ */
+int _ili9341_txn_step_hal(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn) {
+	if (desc->txq_phase != ILI9341_TXN_PHASE_IDLE) {
+		return 0;
+	}
+
+	desc->txq_phase = ILI9341_TXN_PHASE_PAYLOAD;
+	desc->txq_busy = true;
+	int err = desc->spi_tx_txn(txn);
+	return (err < 0) ? err : 1;
+}
+
+void _ili9341_txq_retire(const ili9341_desc_ptr_t desc) {
+	int8_t stage = desc->txq_stage[desc->txq_head];
+	ILI9341_PERF_TXN_END(desc, &desc->txq[desc->txq_head]);
+	if (stage != ILI9341_STAGE_NONE) {
+		desc->stage_refs[stage]--;
+	}
+	_ili9341_seg_ref(desc, &desc->txq[desc->txq_head], -1);
+	desc->txq_head = (desc->txq_head + 1) % ILI9341_TXQ_LEN;
+	desc->txq_cnt--;
+	desc->txq_retired++;
+	desc->txq_phase = ILI9341_TXN_PHASE_IDLE;
 }
 
-int _ili9341_write_data(const ili9341_desc_ptr_t desc, const uint8_t* buffer, uint32_t size) {
+int _ili9341_txq_sync(const ili9341_desc_ptr_t desc) {
 	int err = ILI9341_SUCCESS;
 
-	_ili9341_write_bytes_start(desc);
-	err = _ili9341_write_bytes(desc, buffer, size);
-	_ili9341_write_bytes_end(desc);
+	while (desc->txq_busy) {
+		err = _ili9341_wait_for_spi_ready(desc);
+		if (err < 0) {
+			_ili9341_txq_abort(desc);
+			return err;
+		}
+		err = _ili9341_txq_advance(desc);
+		if (err < 0) {
+			return err;
+		}
+	}
 
 	return err;
 }
 
+/*
+ * Drop all queued transactions. The shadowed registers were marked valid when
+ * queued, the controller may have never received them, so they are sent again
+ * by the next call.
+ */
+void _ili9341_txq_abort(const ili9341_desc_ptr_t desc) {
+	if (desc->cs_pin != NULL) {
+		desc->cs_pin(ILI9341_PIN_SET);
+	}
+	while (desc->txq_cnt > 0) {
+		_ili9341_txq_retire(desc);
+	}
+	desc->txq_busy = false;
+	desc->shadow_valid = 0;
+	desc->region_seg_left = UINT32_MAX;
+}
+
+void _ili9341_lock(const ili9341_desc_ptr_t desc) {
+	if (desc->irq_lock != NULL) {
+		desc->irq_lock();
+	}
+}
+
+void _ili9341_unlock(const ili9341_desc_ptr_t desc) {
+	if (desc->irq_unlock != NULL) {
+		desc->irq_unlock();
+	}
+}
+
 int _ili9341_wait_for_spi_ready(const ili9341_desc_ptr_t desc) {
+	return _ili9341_wait(desc, ILI9341_WAIT_FOR_POLL, _ili9341_is_spi_ready, 0);
+}
+
+/*
+ * Wait loop shared by all waits for a condition, ends when the condition holds
+ * or by the timeout. The time waited is counted to the wait_ms counter.
+ */
+int _ili9341_wait(const ili9341_desc_ptr_t desc, ili9341_wait_for_t what, ili9341_wait_cond_t cond, uint32_t arg) {
+	int err = ILI9341_SUCCESS;
+
 	desc->curr_time_cnt = 0;
-	bool timeout, tx_ready = false;
-	do {
-		tx_ready = desc->spi_tx_ready();
-		timeout = (desc->curr_time_cnt >= desc->timeout_ms);
-	} while(!tx_ready && !timeout);
+	while (!cond(desc, arg)) {
+		if (desc->curr_time_cnt >= desc->timeout_ms) {
+			ILI9341_PERF_INC(desc, timeouts);
+			err = -ILI9341_ERR_COMM_TIMEOUT;
+			break;
+		}
+		_ili9341_wait_step(desc, what, desc->timeout_ms - desc->curr_time_cnt);
+	}
+	ILI9341_PERF_ADD(desc, wait_ms, desc->curr_time_cnt);
 
-	if (timeout) {
-		return -ILI9341_ERR_COMM_TIMEOUT;
+	return err;
+}
+
+/*
+ * One round of a wait loop, the loop checks its condition and the timeout.
+ * Delays and signaled conditions may block up to left_ms, the SPI ready flag
+ * is polled, so it only yields.
+ */
+void _ili9341_wait_step(const ili9341_desc_ptr_t desc, ili9341_wait_for_t what, uint32_t left_ms) {
+	if (what == ILI9341_WAIT_FOR_POLL) {
+		if (desc->wait_strategy != ILI9341_WAIT_SPIN) {
+			desc->wait_yield();
+		}
+		return;
 	}
 
-	return ILI9341_SUCCESS;
+	switch (desc->wait_strategy) {
+	case ILI9341_WAIT_YIELD:
+		desc->wait_yield();
+		break;
+	case ILI9341_WAIT_SLEEP:
+		desc->wait_sleep((what == ILI9341_WAIT_FOR_DELAY) ? left_ms : 1);
+		break;
+	case ILI9341_WAIT_EVENT:
+		desc->wait_event(left_ms);
+		break;
+	default:
+		break;
+	}
 }
 
-void _ili9341_delay_ms(const ili9341_desc_ptr_t desc, uint32_t time_ms) {
-	desc->curr_time_cnt = 0;
-	bool timeout = false;
-	do {
-		timeout = (desc->curr_time_cnt >= time_ms);
-	} while(!timeout);
+bool _ili9341_is_spi_ready(const ili9341_desc_ptr_t desc, uint32_t arg) {
+	(void)arg;
+	ILI9341_PERF_INC(desc, wait_polls);
+	return desc->spi_tx_ready();
+}
+
+bool _ili9341_is_stage_free(const ili9341_desc_ptr_t desc, uint32_t stage) {
+	return desc->stage_refs[stage] == 0;
+}
+
+bool _ili9341_is_seg_free(const ili9341_desc_ptr_t desc, uint32_t table) {
+	return desc->seg_refs[table] == 0;
+}
+
+bool _ili9341_is_txq_free(const ili9341_desc_ptr_t desc, uint32_t arg) {
+	(void)arg;
+	return desc->txq_cnt < ILI9341_TXQ_LEN;
+}
+
+bool _ili9341_is_txq_idle(const ili9341_desc_ptr_t desc, uint32_t arg) {
+	(void)arg;
+	return !desc->txq_busy;
+}
+
+bool _ili9341_is_fence_done(const ili9341_desc_ptr_t desc, uint32_t fence) {
+	return (int32_t)(desc->txq_retired - fence) >= 0;
+}
+
+/*
+ * A TE edge came after count and the frame period is known, the second edge
+ * after ili9341_te_enable at the earliest.
+ */
+bool _ili9341_is_te_measured(const ili9341_desc_ptr_t desc, uint32_t count) {
+	return desc->te_count != count && desc->te_period_ms > 0;
+}
+
+/*
+ * In horizontal orientations the frame memory rows, and so the scrolling
+ * axis, run along the screen x axis.
+ */
+bool _ili9341_rows_swapped(const ili9341_desc_ptr_t desc) {
+	return desc->current_orientation == ILI9341_ORIENTATION_HORIZONTAL ||
+			desc->current_orientation == ILI9341_ORIENTATION_HORIZONTAL_UD;
+}
+
+/*
+ * In upside down orientations the screen coordinate grows against the frame
+ * memory rows.
+ */
+bool _ili9341_rows_flipped(const ili9341_desc_ptr_t desc) {
+	return desc->current_orientation == ILI9341_ORIENTATION_VERTICAL_UD ||
+			desc->current_orientation == ILI9341_ORIENTATION_HORIZONTAL_UD;
+}
+
+/*
+ * Translate screen line along the scrolling axis to the address of the frame
+ * memory line currently displayed there.
+ */
+uint16_t _ili9341_scroll_map(const ili9341_desc_ptr_t desc, uint16_t line) {
+	if (!desc->scroll_on || line >= ILI9341_GRAM_LINES) {
+		return line;
+	}
+
+	bool flipped = _ili9341_rows_flipped(desc);
+	uint16_t row = flipped ? (ILI9341_GRAM_LINES - 1 - line) : line;
+	if (row >= desc->scroll_tfa && row < desc->scroll_tfa + desc->scroll_vsa) {
+		row = desc->scroll_tfa + (row - desc->scroll_tfa + desc->scroll_offset) % desc->scroll_vsa;
+	}
+
+	return flipped ? (ILI9341_GRAM_LINES - 1 - row) : row;
+}
+
+/*
+ * Number of screen lines from first to at most last that map to consecutive
+ * frame memory lines.
+ */
+uint16_t _ili9341_scroll_run(const ili9341_desc_ptr_t desc, uint16_t first, uint16_t last) {
+	uint16_t start = _ili9341_scroll_map(desc, first);
+	uint16_t run = 1;
+
+	while (first + run <= last && _ili9341_scroll_map(desc, first + run) == start + run) {
+		run++;
+	}
+
+	return run;
+}
+
+/*
+ * Set up the window for the part of the current region starting at the given
+ * screen line, up to the next scrolling area wrap.
+ */
+int _ili9341_region_segment(const ili9341_desc_ptr_t desc, uint16_t first) {
+	int err = ILI9341_SUCCESS;
+	uint16_t last = desc->region_bottom_right.y;
+	uint16_t run = _ili9341_scroll_run(desc, first, last);
+	uint16_t start = _ili9341_scroll_map(desc, first);
+
+	ili9341_paset_t paset;
+	paset.fields.sp_h = start >> 8;
+	paset.fields.sp_l = start;
+	paset.fields.ep_h = (start + run - 1) >> 8;
+	paset.fields.ep_l = (start + run - 1);
+	err |= _ili9341_send_shadowed(desc, ILI9341_CMD_PASET, paset.params, desc->shadow_paset.params,
+			sizeof(paset), ILI9341_SHADOW_PASET);
+	/* RAMWR is always needed to move the write pointer back to the region start. */
+	err |= _ili9341_send(desc, ILI9341_CMD_RAMWR, NULL, 0);
+
+	desc->region_next_line = first + run;
+	if (desc->region_next_line > last) {
+		desc->region_seg_left = UINT32_MAX;
+	} else {
+		uint32_t width = desc->region_bottom_right.x - desc->region_top_left.x + 1;
+		desc->region_seg_left = run * width * desc->pixel_size;
+	}
+
+	return err;
 }
 
 bool _ili9341_region_valid(const coord_2d_t* top_left, const coord_2d_t* bottom_right) {
@@ -207,57 +1110,91 @@ void _ili9341_fix_region(coord_2d_t* top_left, coord_2d_t* bottom_right) {
 	}
 }
 
+/*
+ * Range of panel scan lines, i.e. frame memory lines, covered by the region.
+ */
+void _ili9341_panel_lines(const ili9341_desc_ptr_t desc, coord_2d_t top_left, coord_2d_t bottom_right, uint16_t* first, uint16_t* last) {
+	bool swapped = _ili9341_rows_swapped(desc);
+	uint16_t start = swapped ? top_left.x : top_left.y;
+	uint16_t end = swapped ? bottom_right.x : bottom_right.y;
+	if (start > end) {
+		_ili9341_swap(&start, &end);
+	}
+
+	if (_ili9341_rows_flipped(desc)) {
+		*first = ILI9341_GRAM_LINES - 1 - end;
+		*last = ILI9341_GRAM_LINES - 1 - start;
+	} else {
+		*first = start;
+		*last = end;
+	}
+}
+
+#if ILI9341_PERF
+/*
+ * Called for the transaction at the queue head before each step, counts it
+ * once when its first transfer starts.
+ */
+void _ili9341_perf_txn_begin(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn) {
+	if (desc->txq_phase != ILI9341_TXN_PHASE_IDLE) {
+		return;
+	}
+
+	uint8_t cmd = (txn->flags & ILI9341_TXN_FLAG_NO_CMD) ? ILI9341_CMD_NOP : txn->cmd;
+	desc->perf.transactions++;
+	desc->perf.commands[cmd]++;
+	desc->perf.bytes_sent += ((txn->flags & ILI9341_TXN_FLAG_NO_CMD) ? 0 : ILI9341_CMD_LEN) +
+			txn->params_len + txn->payload_len;
+	if (desc->trace_begin != NULL) {
+		desc->trace_begin(desc, ILI9341_TRACE_TXN, cmd);
+	}
+}
+
+void _ili9341_perf_txn_end(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn) {
+	if (desc->trace_end != NULL) {
+		desc->trace_end(desc, ILI9341_TRACE_TXN, (txn->flags & ILI9341_TXN_FLAG_NO_CMD) ? ILI9341_CMD_NOP : txn->cmd);
+	}
+}
+#endif
+
 /* Public interface methods. */
 
 ili9341_hw_cfg_t ili9341_get_default_hw_cfg() {
-	ili9341_hw_cfg_t def_cfg;
-	uint8_t powctrla[] = {0x39, 0x2C, 0x00, 0x34, 0x02};
-	memcpy(def_cfg.pwctrla.params, &powctrla, sizeof(ili9341_pwctrla_t));
-	uint8_t powctrlb[] = {0x00, 0xC1, 0x30};
-	memcpy(def_cfg.pwctrlb.params, &powctrlb, sizeof(ili9341_pwctrlb_t));
-	uint8_t timctrla[] = {0x85, 0x00, 0x78};
-	memcpy(def_cfg.timctrla.params, &timctrla, sizeof(ili9341_timctrla_t));
-	uint8_t timctrlb[] = {0xEA, 0x00, 0x00};
-	memcpy(def_cfg.timctrlb.params, &timctrlb, sizeof(ili9341_timctrlb_t));
-	uint8_t ponseqctrl[] = {0x64, 0x03, 0x12, 0x81};
-	memcpy(def_cfg.ponseqctrl.params, &ponseqctrl, sizeof(ili9341_ponseqctrl_t));
-	uint8_t pumpratctrl[] = {0x20};
-	memcpy(def_cfg.pumpratctrl.params, &pumpratctrl, sizeof(ili9341_pumpratctrl_t));
-	uint8_t pwctr1[] = {0x23};
-	memcpy(def_cfg.pwctr1.params, &pwctr1, sizeof(ili9341_pwctr1_t));
-	uint8_t pwctr2[] = {0x10};
-	memcpy(def_cfg.pwctr2.params, &pwctr2, sizeof(ili9341_pwctr2_t));
-	uint8_t vmctr1[] = {0x3E, 0x28};
-	memcpy(def_cfg.vmctr1.params, &vmctr1, sizeof(ili9341_vmctr1_t));
-	uint8_t vmctr2[] = {0x86};
-	memcpy(def_cfg.vmctr2.params, &vmctr2, sizeof(ili9341_vmctr2_t));
-	uint8_t madctl[] = {0x48};
-	memcpy(def_cfg.madctl.params, &madctl, sizeof(ili9341_madctl_t));
-	uint8_t pixfmt[] = {0x55};
-	memcpy(def_cfg.pixfmt.params, &pixfmt, sizeof(ili9341_pixfmt_t));
-	uint8_t frmctr1[] = {0x00, 0x18};
-	memcpy(def_cfg.frmctr1.params, &frmctr1, sizeof(ili9341_frmctr1_t));
-	uint8_t dfunctr[] = {0x08, 0x82, 0x27};
-	memcpy(def_cfg.dfunctr.params, &dfunctr, sizeof(ili9341_dfunctr_t));
-	uint8_t g3enable[] = {0x00};
-	memcpy(def_cfg.g3enable.params, &g3enable, sizeof(ili9341_3genable_t));
-	uint8_t gammaset[] = {0x01};
-	memcpy(def_cfg.gammaset.params, &gammaset, sizeof(ili9341_gammaset_t));
-	uint8_t gmctrp1[] = {0x0F, 0x31, 0x2B, 0x0C, 0x0E, 0x08, 0x4E, 0xF1, 0x37, 0x07, 0x10, 0x03, 0x0E, 0x09, 0x00};
-	memcpy(def_cfg.gmctrp1.params, &gmctrp1, sizeof(ili9341_gmctrp1_t));
-	uint8_t gmctrn1[] = {0x00, 0x0E, 0x14, 0x03, 0x11, 0x07, 0x31, 0xC1, 0x48, 0x08, 0x0F, 0x0C, 0x31, 0x36, 0x0F};
-	memcpy(def_cfg.gmctrn1.params, &gmctrn1, sizeof(ili9341_gmctrn1_t));
-
-	return def_cfg;
+	return ili9341_default_hw_cfg;
 }
 
 ili9341_desc_ptr_t ili9341_init(const ili9341_cfg_t* cfg, const ili9341_hw_cfg_t* hw_cfg) {
+	ili9341_desc_ptr_t desc = ili9341_init_start(cfg, hw_cfg);
+	if (desc == NULL) {
+		return NULL;
+	}
+
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_INIT);
+	while (!ili9341_init_done(desc)) {
+		if (ili9341_init_poll(desc) < 0) {
+			return NULL;
+		}
+		uint32_t elapsed = desc->curr_time_cnt;
+		if (desc->init_delay_ms > elapsed) {
+			_ili9341_wait_step(desc, ILI9341_WAIT_FOR_DELAY, desc->init_delay_ms - elapsed);
+		}
+	}
+	(void)ILI9341_PERF_API_END(desc, ILI9341_API_INIT, ILI9341_SUCCESS);
+
+	return desc;
+}
+
+ili9341_desc_ptr_t ili9341_init_start(const ili9341_cfg_t* cfg, const ili9341_hw_cfg_t* hw_cfg) {
 	  if (cfg == NULL ||
-		  cfg->spi_tx_dma == NULL ||
 		  cfg->spi_tx_ready == NULL ||
-		  cfg->rst_pin == NULL ||
-		  cfg->cs_pin == NULL ||
-		  cfg->dc_pin == NULL) {
+		  cfg->rst_pin == NULL) {
+	      return NULL;
+	  }
+
+	  if (cfg->spi_tx_txn == NULL &&
+		  (cfg->spi_tx_dma == NULL ||
+		   cfg->cs_pin == NULL ||
+		   cfg->dc_pin == NULL)) {
 	      return NULL;
 	  }
 
@@ -265,6 +1202,14 @@ ili9341_desc_ptr_t ili9341_init(const ili9341_cfg_t* cfg, const ili9341_hw_cfg_t
 		  return NULL;
 	  }
 
+	  /* All but the spinning strategy yield while polling the SPI ready flag. */
+	  if ((cfg->wait_strategy != ILI9341_WAIT_SPIN && cfg->wait_yield == NULL) ||
+		  (cfg->wait_strategy == ILI9341_WAIT_SLEEP && cfg->wait_sleep == NULL) ||
+		  (cfg->wait_strategy == ILI9341_WAIT_EVENT && (cfg->wait_event == NULL || cfg->wait_signal == NULL)) ||
+		  cfg->wait_strategy > ILI9341_WAIT_EVENT) {
+	      return NULL;
+	  }
+
 	  if (ili9341_drivers_pool.current_driver >= ILI9341_MAX_DRIVERS_CNT) {
 	      return NULL;
 	  }
@@ -276,9 +1221,13 @@ ili9341_desc_ptr_t ili9341_init(const ili9341_cfg_t* cfg, const ili9341_hw_cfg_t
 	  driver_desc->current_height = cfg->height;
 	  driver_desc->default_orientation = cfg->orientation;
 	  driver_desc->current_orientation = cfg->orientation;
+	  driver_desc->pixel_size = (hw_cfg->pixfmt.fields.dbi == ILI9341_PIXFMT_18BIT_DBI) ? 3 : 2;
 
 	  driver_desc->spi_tx_dma = cfg->spi_tx_dma;
 	  driver_desc->spi_tx_ready = cfg->spi_tx_ready;
+	  driver_desc->spi_tx_txn = cfg->spi_tx_txn;
+	  driver_desc->spi_tx_repeat = cfg->spi_tx_repeat;
+	  driver_desc->spi_tx_dma_sg = cfg->spi_tx_dma_sg;
 	  driver_desc->rst_pin = cfg->rst_pin;
 	  driver_desc->cs_pin = cfg->cs_pin;
 	  driver_desc->dc_pin = cfg->dc_pin;
@@ -287,127 +1236,704 @@ ili9341_desc_ptr_t ili9341_init(const ili9341_cfg_t* cfg, const ili9341_hw_cfg_t
 	  driver_desc->restart_delay_ms = cfg->restart_delay_ms;
 	  driver_desc->wup_delay_ms = cfg->wup_delay_ms;
 	  driver_desc->curr_time_cnt = 0;
+	  driver_desc->uptime_ms = 0;
 
-	  if (_ili9341_init_display(driver_desc, hw_cfg) < 0) {
-		  return NULL;
+	  driver_desc->dma_async = cfg->dma_async;
+	  driver_desc->irq_lock = cfg->irq_lock;
+	  driver_desc->irq_unlock = cfg->irq_unlock;
+	  driver_desc->wait_strategy = cfg->wait_strategy;
+	  driver_desc->wait_yield = cfg->wait_yield;
+	  driver_desc->wait_sleep = cfg->wait_sleep;
+	  driver_desc->wait_event = cfg->wait_event;
+	  driver_desc->wait_signal = cfg->wait_signal;
+	  driver_desc->txq_head = 0;
+	  driver_desc->txq_tail = 0;
+	  driver_desc->txq_cnt = 0;
+	  driver_desc->txq_phase = ILI9341_TXN_PHASE_IDLE;
+	  driver_desc->txq_busy = false;
+	  driver_desc->txq_defer = false;
+	  driver_desc->txq_err = ILI9341_SUCCESS;
+	  driver_desc->txq_pushed = 0;
+	  driver_desc->txq_retired = 0;
+	  driver_desc->stage_next = 0;
+	  for (int i = 0; i < ILI9341_STAGING_BUF_CNT; i++) {
+		  driver_desc->stage_refs[i] = 0;
 	  }
+	  driver_desc->seg_next = 0;
+	  for (int i = 0; i < ILI9341_SEG_TABLE_CNT; i++) {
+		  driver_desc->seg_refs[i] = 0;
+	  }
+	  driver_desc->txn_observer = NULL;
+	  driver_desc->txn_observer_ctx = NULL;
+
+	  driver_desc->init_done = false;
+	  driver_desc->init_hw_cfg = hw_cfg;
+	  driver_desc->init_pos = 0;
+	  driver_desc->init_delay_ms = 0;
+	  driver_desc->shadow_valid = 0;
+	  driver_desc->scroll_on = false;
+	  driver_desc->region_seg_left = UINT32_MAX;
+	  driver_desc->te_on = false;
+	  driver_desc->te_count = 0;
+	  driver_desc->te_period_ms = 0;
+#if ILI9341_PERF
+	  memset(&driver_desc->perf, 0, sizeof(driver_desc->perf));
+	  driver_desc->trace_begin = NULL;
+	  driver_desc->trace_end = NULL;
+#endif
+
+	  ILI9341_PERF_API_BEGIN(driver_desc, ILI9341_API_INIT_START);
+	  _ili9341_enable(driver_desc);
+	  (void)ILI9341_PERF_API_END(driver_desc, ILI9341_API_INIT_START, ILI9341_SUCCESS);
 
 	  return driver_desc;
 }
 
+int ili9341_init_poll(const ili9341_desc_ptr_t desc) {
+	if (desc->init_done) {
+		return ILI9341_SUCCESS;
+	}
+
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_INIT_POLL);
+	int err = _ili9341_init_step(desc);
+	return ILI9341_PERF_API_END(desc, ILI9341_API_INIT_POLL, err);
+}
+
+bool ili9341_init_done(const ili9341_desc_ptr_t desc) {
+	return desc->init_done;
+}
+
 int ili9341_set_orientation(const ili9341_desc_ptr_t desc, ili9341_orientation_t orientation) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_SET_ORIENTATION);
 	int err = ILI9341_SUCCESS;
 	ili9341_madctl_t madctl;
 	madctl.params[0] = 0x00;
 	switch (orientation) {
 	case ILI9341_ORIENTATION_VERTICAL:
-		err |= _ili9341_write_cmd(desc, ILI9341_CMD_MADCTL);
 		desc->current_width = desc->default_height;
 		desc->current_height = desc->default_width;
 		madctl.params[0] = 0x40|0x08;
 		break;
 	case ILI9341_ORIENTATION_VERTICAL_UD:
-		err |= _ili9341_write_cmd(desc, ILI9341_CMD_MADCTL);
 		desc->current_width = desc->default_height;
 		desc->current_height = desc->default_width;
 		madctl.params[0] = 0x80|0x08;
 		break;
 	case ILI9341_ORIENTATION_HORIZONTAL:
-		err |= _ili9341_write_cmd(desc, ILI9341_CMD_MADCTL);
 		desc->current_width = desc->default_width;
 		desc->current_height = desc->default_height;
 		madctl.params[0] = 0x20|0x08;
 		break;
 	case ILI9341_ORIENTATION_HORIZONTAL_UD:
-		err |= _ili9341_write_cmd(desc, ILI9341_CMD_MADCTL);
 		desc->current_width = desc->default_width;
 		desc->current_height = desc->default_height;
 		madctl.params[0] = 0x40|0x80|0x20|0x08;
 		break;
 	default:
-		err = -ILI9341_ERR_INV_PARAM;
-		break;
+		return ILI9341_PERF_API_END(desc, ILI9341_API_SET_ORIENTATION, -ILI9341_ERR_INV_PARAM);
 	}
 
-	err |= _ili9341_write_data(desc, madctl.params, sizeof(madctl));
+	desc->current_orientation = orientation;
+	err |= _ili9341_send_shadowed(desc, ILI9341_CMD_MADCTL, madctl.params, desc->shadow_madctl.params,
+			sizeof(madctl), ILI9341_SHADOW_MADCTL);
 
-	return err;
+	return ILI9341_PERF_API_END(desc, ILI9341_API_SET_ORIENTATION, err);
 }
 
 int ili9341_set_region(const ili9341_desc_ptr_t desc, coord_2d_t top_left, coord_2d_t bottom_right) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_SET_REGION);
 	int err = ILI9341_SUCCESS;
 	if (!_ili9341_region_valid(&top_left, &bottom_right)) {
 		_ili9341_fix_region(&top_left, &bottom_right);
 	}
 
+	/* Along x, a scrolling area wrap would split every line, such regions are not supported. */
+	uint16_t start_x = top_left.x;
+	if (desc->scroll_on && _ili9341_rows_swapped(desc)) {
+		if (_ili9341_scroll_run(desc, top_left.x, bottom_right.x) <= bottom_right.x - top_left.x) {
+			return ILI9341_PERF_API_END(desc, ILI9341_API_SET_REGION, -ILI9341_ERR_INV_PARAM);
+		}
+		start_x = _ili9341_scroll_map(desc, top_left.x);
+	}
+
 	desc->region_top_left = top_left;
 	desc->region_bottom_right = bottom_right;
 
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_CASET);
 	ili9341_caset_t caset;
-	caset.fields.sc_h = top_left.x >> 8;
-	caset.fields.sc_l = top_left.x;
-	caset.fields.ec_h = bottom_right.x >> 8;
-	caset.fields.ec_l = bottom_right.x;
-	err |= _ili9341_write_data(desc, caset.params, sizeof(caset));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_PASET);
+	uint16_t end_x = start_x + (bottom_right.x - top_left.x);
+	caset.fields.sc_h = start_x >> 8;
+	caset.fields.sc_l = start_x;
+	caset.fields.ec_h = end_x >> 8;
+	caset.fields.ec_l = end_x;
+	err |= _ili9341_send_shadowed(desc, ILI9341_CMD_CASET, caset.params, desc->shadow_caset.params,
+			sizeof(caset), ILI9341_SHADOW_CASET);
+
+	if (desc->scroll_on && !_ili9341_rows_swapped(desc)) {
+		err |= _ili9341_region_segment(desc, top_left.y);
+		return ILI9341_PERF_API_END(desc, ILI9341_API_SET_REGION, err);
+	}
 
 	ili9341_paset_t paset;
 	paset.fields.sp_h = top_left.y >> 8;
 	paset.fields.sp_l = top_left.y;
 	paset.fields.ep_h = bottom_right.y >> 8;
 	paset.fields.ep_l = bottom_right.y;
-	err |= _ili9341_write_data(desc, paset.params, sizeof(paset));
-	err |= _ili9341_write_cmd(desc, ILI9341_CMD_RAMWR);
+	err |= _ili9341_send_shadowed(desc, ILI9341_CMD_PASET, paset.params, desc->shadow_paset.params,
+			sizeof(paset), ILI9341_SHADOW_PASET);
+	/* RAMWR is always needed to move the write pointer back to the region start. */
+	err |= _ili9341_send(desc, ILI9341_CMD_RAMWR, NULL, 0);
+	desc->region_seg_left = UINT32_MAX;
 
-	return err;
+	return ILI9341_PERF_API_END(desc, ILI9341_API_SET_REGION, err);
 }
 
 int ili9341_fill_region(const ili9341_desc_ptr_t desc, uint16_t color) {
-	int err = ILI9341_SUCCESS;
-
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_FILL_REGION);
 	uint32_t width = desc->region_bottom_right.x - desc->region_top_left.x+1;
 	uint32_t height = desc->region_bottom_right.y - desc->region_top_left.y + 1;
-	uint32_t size = width*height;
-	const int BUFF_SIZE = 1024;
 
-	uint8_t buffer[BUFF_SIZE];
-	uint8_t color_lsb = color&0xFF;
-	uint8_t color_msb = (color>>8)&0xFF;
+	int err = ili9341_fill_pixels(desc, color, width*height);
+	return ILI9341_PERF_API_END(desc, ILI9341_API_FILL_REGION, err);
+}
+
+int ili9341_fill_pixels(const ili9341_desc_ptr_t desc, uint16_t color, uint32_t size) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_FILL_PIXELS);
+	int err = ILI9341_SUCCESS;
+
+	if (size == 0) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_FILL_PIXELS, err);
+	}
+
+	uint8_t pixel[3];
+	ili9341_color_to_pixel(desc, color, pixel);
+
+	/* Segments hold whole pixels. */
+	uint32_t seg_size = ILI9341_STAGING_BUF_SIZE - ILI9341_STAGING_BUF_SIZE % desc->pixel_size;
+	uint32_t tx_size = size*desc->pixel_size;
+	uint32_t segments = tx_size/seg_size;
+	uint32_t rest = tx_size%seg_size;
+	uint32_t pattern_size = (segments > 0) ? seg_size : rest;
+
+	/* Solid color needs just one staging buffer, committed for every segment. */
+	int8_t stage;
+	uint8_t* buffer = _ili9341_stream_acquire(desc, &stage);
+	if (buffer == NULL) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_FILL_PIXELS, -ILI9341_ERR_COMM_TIMEOUT);
+	}
+
+	/* Constant source DMA sends the whole region in one request. */
+	if (desc->spi_tx_repeat != NULL && desc->pixel_size == ILI9341_REPEAT_PATTERN_LEN) {
+		buffer[0] = pixel[0];
+		buffer[1] = pixel[1];
+		err |= _ili9341_stream_commit_repeat(desc, stage, tx_size);
+		return ILI9341_PERF_API_END(desc, ILI9341_API_FILL_PIXELS, err);
+	}
+
+	for (uint32_t i = 0; i < pattern_size; i+=desc->pixel_size) {
+		memcpy(&buffer[i], pixel, desc->pixel_size);
+	}
+
+	if (_ili9341_seg_enabled(desc)) {
+		uint32_t left = tx_size;
+		while (left > 0 && err >= 0) {
+			int8_t table;
+			ili9341_seg_t* segs = _ili9341_seg_acquire(desc, &table);
+			if (segs == NULL) {
+				return ILI9341_PERF_API_END(desc, ILI9341_API_FILL_PIXELS, -ILI9341_ERR_COMM_TIMEOUT);
+			}
+
+			uint16_t cnt = 0;
+			while (left > 0 && cnt < ILI9341_SEG_TABLE_LEN) {
+				segs[cnt].data = buffer;
+				segs[cnt].len = (left > seg_size) ? seg_size : left;
+				left -= segs[cnt].len;
+				cnt++;
+			}
+			err |= _ili9341_seg_commit(desc, table, cnt, stage);
+		}
+		return ILI9341_PERF_API_END(desc, ILI9341_API_FILL_PIXELS, err);
+	}
+
+	for (uint32_t seg = 0; seg < segments; seg++) {
+		err |= _ili9341_stream_commit(desc, stage, seg_size);
+	}
+	if (rest > 0) {
+		err |= _ili9341_stream_commit(desc, stage, rest);
+	}
+
+	return ILI9341_PERF_API_END(desc, ILI9341_API_FILL_PIXELS, err);
+}
+
+int ili9341_scroll_setup(const ili9341_desc_ptr_t desc, uint16_t top_fixed, uint16_t bottom_fixed) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_SCROLL_SETUP);
+	int err = ILI9341_SUCCESS;
+
+	if ((uint32_t)top_fixed + bottom_fixed >= ILI9341_GRAM_LINES) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_SCROLL_SETUP, -ILI9341_ERR_INV_PARAM);
+	}
+
+	/* The controller counts the areas from the first frame memory line. */
+	uint16_t tfa = _ili9341_rows_flipped(desc) ? bottom_fixed : top_fixed;
+	uint16_t bfa = _ili9341_rows_flipped(desc) ? top_fixed : bottom_fixed;
+	uint16_t vsa = ILI9341_GRAM_LINES - tfa - bfa;
+
+	ili9341_vscrdef_t vscrdef;
+	vscrdef.fields.tfa_h = tfa >> 8;
+	vscrdef.fields.tfa_l = tfa;
+	vscrdef.fields.vsa_h = vsa >> 8;
+	vscrdef.fields.vsa_l = vsa;
+	vscrdef.fields.bfa_h = bfa >> 8;
+	vscrdef.fields.bfa_l = bfa;
+	err |= _ili9341_send(desc, ILI9341_CMD_VSCRDEF, vscrdef.params, sizeof(vscrdef));
+
+	desc->scroll_tfa = tfa;
+	desc->scroll_vsa = vsa;
+	desc->scroll_offset = 0;
+	desc->scroll_on = true;
+	err |= ili9341_scroll_set(desc, 0);
+
+	return ILI9341_PERF_API_END(desc, ILI9341_API_SCROLL_SETUP, err);
+}
+
+int ili9341_scroll_set(const ili9341_desc_ptr_t desc, uint16_t offset) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_SCROLL);
+	if (!desc->scroll_on) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_SCROLL, -ILI9341_ERR_INV_PARAM);
+	}
+
+	offset %= desc->scroll_vsa;
+	if (_ili9341_rows_flipped(desc) && offset > 0) {
+		offset = desc->scroll_vsa - offset;
+	}
+	desc->scroll_offset = offset;
+
+	uint16_t vsp = desc->scroll_tfa + offset;
+	ili9341_vscrsadd_t vscrsadd;
+	vscrsadd.fields.vsp_h = vsp >> 8;
+	vscrsadd.fields.vsp_l = vsp;
+
+	int err = _ili9341_send(desc, ILI9341_CMD_VSCRSADD, vscrsadd.params, sizeof(vscrsadd));
+	return ILI9341_PERF_API_END(desc, ILI9341_API_SCROLL, err);
+}
+
+int ili9341_scroll(const ili9341_desc_ptr_t desc, int16_t lines) {
+	if (!desc->scroll_on) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+
+	int32_t offset = _ili9341_rows_flipped(desc) ?
+			(int32_t)(desc->scroll_vsa - desc->scroll_offset) % desc->scroll_vsa : desc->scroll_offset;
+	offset = (offset + lines) % desc->scroll_vsa;
+	if (offset < 0) {
+		offset += desc->scroll_vsa;
+	}
+
+	return ili9341_scroll_set(desc, (uint16_t)offset);
+}
+
+int ili9341_scroll_stop(const ili9341_desc_ptr_t desc) {
+	int err = ILI9341_SUCCESS;
+
+	if (!desc->scroll_on) {
+		return err;
+	}
+
+	err |= ili9341_scroll_set(desc, 0);
+	err |= _ili9341_send(desc, ILI9341_CMD_NORON, NULL, 0);
+	desc->scroll_on = false;
+
+	return err;
+}
+
+int ili9341_partial_on(const ili9341_desc_ptr_t desc, coord_2d_t top_left, coord_2d_t bottom_right) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_PARTIAL_ON);
+	int err = ILI9341_SUCCESS;
+	uint16_t first, last;
+
+	_ili9341_panel_lines(desc, top_left, bottom_right, &first, &last);
+	if (last >= ILI9341_GRAM_LINES) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_PARTIAL_ON, -ILI9341_ERR_INV_PARAM);
+	}
+
+	ili9341_partar_t partar;
+	partar.fields.sr_h = first >> 8;
+	partar.fields.sr_l = first;
+	partar.fields.er_h = last >> 8;
+	partar.fields.er_l = last;
+	err |= _ili9341_send(desc, ILI9341_CMD_PARTAR, partar.params, sizeof(partar));
+	err |= _ili9341_send(desc, ILI9341_CMD_PTLON, NULL, 0);
+
+	return ILI9341_PERF_API_END(desc, ILI9341_API_PARTIAL_ON, err);
+}
+
+int ili9341_partial_off(const ili9341_desc_ptr_t desc) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_PARTIAL_OFF);
+	int err = _ili9341_send(desc, ILI9341_CMD_NORON, NULL, 0);
+	return ILI9341_PERF_API_END(desc, ILI9341_API_PARTIAL_OFF, err);
+}
+
+int ili9341_te_enable(const ili9341_desc_ptr_t desc, uint16_t line) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_TE_ENABLE);
+	int err = ILI9341_SUCCESS;
+
+	if (line >= ILI9341_GRAM_LINES) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_TE_ENABLE, -ILI9341_ERR_INV_PARAM);
+	}
+
+	ili9341_settearsl_t settearsl;
+	settearsl.fields.sts_h = line >> 8;
+	settearsl.fields.sts_l = line;
+	err |= _ili9341_send(desc, ILI9341_CMD_SETTEARSL, settearsl.params, sizeof(settearsl));
+
+	/* Mode 0, V-Blank information only. */
+	ili9341_tearon_t tearon;
+	tearon.params[0] = 0x00;
+	err |= _ili9341_send(desc, ILI9341_CMD_TEARON, tearon.params, sizeof(tearon));
+
+	/* Edges before the reconfiguration do not measure the new signal. */
+	_ili9341_lock(desc);
+	desc->te_line = line;
+	desc->te_count = 0;
+	desc->te_last_ms = 0;
+	desc->te_period_ms = 0;
+	desc->te_on = (err == ILI9341_SUCCESS);
+	_ili9341_unlock(desc);
+
+	return ILI9341_PERF_API_END(desc, ILI9341_API_TE_ENABLE, err);
+}
+
+int ili9341_te_disable(const ili9341_desc_ptr_t desc) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_TE_DISABLE);
+	desc->te_on = false;
+	int err = _ili9341_send(desc, ILI9341_CMD_TEAROFF, NULL, 0);
+	return ILI9341_PERF_API_END(desc, ILI9341_API_TE_DISABLE, err);
+}
+
+void ili9341_te_cb(const ili9341_desc_ptr_t desc) {
+	uint32_t now = desc->uptime_ms;
+	if (desc->te_count > 0) {
+		desc->te_period_ms = now - desc->te_last_ms;
+	}
+	desc->te_last_ms = now;
+	desc->te_count++;
+	if (desc->wait_signal != NULL) {
+		desc->wait_signal();
+	}
+}
+
+int ili9341_te_wait_line(const ili9341_desc_ptr_t desc, uint16_t line) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_TE_WAIT_LINE);
+	if (!desc->te_on) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_TE_WAIT_LINE, -ILI9341_ERR_INV_PARAM);
+	}
+
+	int err = _ili9341_wait(desc, ILI9341_WAIT_FOR_SIGNAL, _ili9341_is_te_measured, desc->te_count);
+	if (err < 0) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_TE_WAIT_LINE, err);
+	}
+
+	/* The TE edge comes when the scan is at te_line, round up to stay behind the scan. */
+	uint32_t lines_ahead = (line + ILI9341_GRAM_LINES - desc->te_line) % ILI9341_GRAM_LINES;
+	uint32_t delay_ms = (lines_ahead * desc->te_period_ms + ILI9341_GRAM_LINES - 1) / ILI9341_GRAM_LINES;
+	desc->curr_time_cnt = 0;
+	while (desc->curr_time_cnt < delay_ms) {
+		_ili9341_wait_step(desc, ILI9341_WAIT_FOR_DELAY, delay_ms - desc->curr_time_cnt);
+	}
+
+	return ILI9341_PERF_API_END(desc, ILI9341_API_TE_WAIT_LINE, ILI9341_SUCCESS);
+}
+
+int ili9341_te_present(const ili9341_desc_ptr_t desc, coord_2d_t top_left, coord_2d_t bottom_right,
+		const uint8_t* data, uint32_t size) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_TE_PRESENT);
+	int err = ILI9341_SUCCESS;
+	uint16_t first, last;
+
+	/* Earlier queued transfers would delay the start past the scheduled moment. */
+	err |= ili9341_wait_idle(desc);
+	if (err < 0) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_TE_PRESENT, err);
+	}
 
-	uint32_t tx_size = size*2;
-	uint32_t segments = tx_size/BUFF_SIZE;
-	uint32_t rest = tx_size%BUFF_SIZE;
+	_ili9341_panel_lines(desc, top_left, bottom_right, &first, &last);
+	err |= ili9341_te_wait_line(desc, first);
+	if (err < 0) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_TE_PRESENT, err);
+	}
+
+	err |= ili9341_set_region(desc, top_left, bottom_right);
+	err |= ili9341_draw_RGB565_dma(desc, data, size);
+
+	return ILI9341_PERF_API_END(desc, ILI9341_API_TE_PRESENT, err);
+}
+
+int ili9341_perf_snapshot(const ili9341_desc_ptr_t desc, ili9341_perf_t* perf) {
+#if ILI9341_PERF
+	_ili9341_lock(desc);
+	*perf = desc->perf;
+	_ili9341_unlock(desc);
+	return ILI9341_SUCCESS;
+#else
+	(void)desc;
+	memset(perf, 0, sizeof(*perf));
+	return -ILI9341_ERR_INV_PARAM;
+#endif
+}
 
-	for (int i = 0; i < BUFF_SIZE; i+=2) {
-		buffer[i] = color_msb;
-		buffer[i+1] = color_lsb;
+void ili9341_perf_reset(const ili9341_desc_ptr_t desc) {
+#if ILI9341_PERF
+	_ili9341_lock(desc);
+	memset(&desc->perf, 0, sizeof(desc->perf));
+	_ili9341_unlock(desc);
+#else
+	(void)desc;
+#endif
+}
+
+#if ILI9341_PERF
+uint32_t ili9341_perf_api_begin(const ili9341_desc_ptr_t desc, ili9341_api_t api) {
+	if (desc->trace_begin != NULL) {
+		desc->trace_begin(desc, ILI9341_TRACE_API, api);
 	}
+	return desc->uptime_ms;
+}
+
+int ili9341_perf_api_end(const ili9341_desc_ptr_t desc, ili9341_api_t api, uint32_t start_ms, int err) {
+	uint32_t duration_ms = desc->uptime_ms - start_ms;
 
-	_ili9341_write_bytes_start(desc);
-	for (int seg = 0; seg <= segments; seg++) {
-		err |= _ili9341_write_bytes(desc, buffer, BUFF_SIZE);
-		_ili9341_wait_for_spi_ready(desc);
+	desc->perf.api_calls[api]++;
+	if (duration_ms > desc->perf.api_max_ms[api]) {
+		desc->perf.api_max_ms[api] = duration_ms;
+	}
+	if (desc->trace_end != NULL) {
+		desc->trace_end(desc, ILI9341_TRACE_API, api);
 	}
-	err |= _ili9341_write_bytes(desc, buffer, rest);
-	_ili9341_wait_for_spi_ready(desc);
-	_ili9341_write_bytes_end(desc);
 
-	return -err;
+	return err;
+}
+#endif
+
+int ili9341_perf_set_trace(const ili9341_desc_ptr_t desc, ili9341_trace_cb_t begin, ili9341_trace_cb_t end) {
+#if ILI9341_PERF
+	_ili9341_lock(desc);
+	desc->trace_begin = begin;
+	desc->trace_end = end;
+	_ili9341_unlock(desc);
+	return ILI9341_SUCCESS;
+#else
+	(void)desc;
+	(void)begin;
+	(void)end;
+	return -ILI9341_ERR_INV_PARAM;
+#endif
 }
 
 void ili9341_1ms_timer_cb() {
 	for (int i = 0; i < ili9341_drivers_pool.current_driver; i++) {
-		ili9341_drivers_pool.drivers[i].curr_time_cnt++;
+		ili9341_1ms_tick(&ili9341_drivers_pool.drivers[i]);
 	}
 }
 
+void ili9341_1ms_tick(const ili9341_desc_ptr_t desc) {
+	desc->curr_time_cnt++;
+	desc->uptime_ms++;
+}
+
 int ili9341_draw_RGB565_dma(const ili9341_desc_ptr_t desc, const uint8_t* data, uint32_t size) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_DRAW_RGB565);
 	int err = ILI9341_SUCCESS;
 
-	err |= _ili9341_write_data(desc, data, size);
+	if (desc->pixel_size == 3) {
+		ili9341_blit_src_t src = {data, size, size, false};
+		err |= _ili9341_stream(desc, size / 2 * 3, _ili9341_expand_rows, &src);
+		return ILI9341_PERF_API_END(desc, ILI9341_API_DRAW_RGB565, err);
+	}
+
+	err |= _ili9341_send_payload(desc, data, size);
 
-	return err;
+	return ILI9341_PERF_API_END(desc, ILI9341_API_DRAW_RGB565, err);
+}
+
+int ili9341_draw_RGB666_dma(const ili9341_desc_ptr_t desc, const uint8_t* data, uint32_t size) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_DRAW_RGB666);
+	if (desc->pixel_size != 3) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_DRAW_RGB666, -ILI9341_ERR_INV_PARAM);
+	}
+
+	int err = _ili9341_send_payload(desc, data, size);
+	return ILI9341_PERF_API_END(desc, ILI9341_API_DRAW_RGB666, err);
+}
+
+int ili9341_blit_RGB565(const ili9341_desc_ptr_t desc, coord_2d_t top_left, const uint8_t* data,
+		uint32_t stride, uint16_t width, uint16_t height) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_BLIT_RGB565);
+	int err = ILI9341_SUCCESS;
+
+	if (data == NULL || width == 0 || height == 0) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_BLIT_RGB565, -ILI9341_ERR_INV_PARAM);
+	}
+
+	uint32_t row_len = (uint32_t)width * 2;
+	if (stride < row_len) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_BLIT_RGB565, -ILI9341_ERR_INV_PARAM);
+	}
+
+	coord_2d_t bottom_right = {top_left.x + width - 1, top_left.y + height - 1};
+	err |= ili9341_set_region(desc, top_left, bottom_right);
+	if (err < 0) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_BLIT_RGB565, err);
+	}
+
+	if (desc->pixel_size == 3) {
+		ili9341_blit_src_t src = {data, stride, row_len, false};
+		err |= _ili9341_stream(desc, (uint32_t)width * height * 3, _ili9341_expand_rows, &src);
+		return ILI9341_PERF_API_END(desc, ILI9341_API_BLIT_RGB565, err);
+	}
+
+	/* Rows next to each other in the source go out in one transfer. */
+	if (stride == row_len || height == 1) {
+		err |= _ili9341_send_payload(desc, data, row_len * height);
+		return ILI9341_PERF_API_END(desc, ILI9341_API_BLIT_RGB565, err);
+	}
+
+	/* Copying short rows is cheaper than a transfer per row. */
+	if (row_len < ILI9341_BLIT_GATHER_LEN) {
+		ili9341_blit_src_t src = {data, stride, row_len, false};
+		err |= _ili9341_stream(desc, row_len * height, _ili9341_gather_rows, &src);
+		return ILI9341_PERF_API_END(desc, ILI9341_API_BLIT_RGB565, err);
+	}
+
+	if (_ili9341_seg_enabled(desc)) {
+		uint16_t y = 0;
+		while (y < height) {
+			int8_t table;
+			ili9341_seg_t* segs = _ili9341_seg_acquire(desc, &table);
+			if (segs == NULL) {
+				return ILI9341_PERF_API_END(desc, ILI9341_API_BLIT_RGB565, -ILI9341_ERR_COMM_TIMEOUT);
+			}
+
+			uint16_t cnt = 0;
+			for (; y < height && cnt < ILI9341_SEG_TABLE_LEN; y++, cnt++) {
+				segs[cnt].data = data;
+				segs[cnt].len = row_len;
+				data += stride;
+			}
+			err |= _ili9341_seg_commit(desc, table, cnt, ILI9341_STAGE_NONE);
+			if (err < 0) {
+				return ILI9341_PERF_API_END(desc, ILI9341_API_BLIT_RGB565, err);
+			}
+		}
+		return ILI9341_PERF_API_END(desc, ILI9341_API_BLIT_RGB565, err);
+	}
+
+	for (uint16_t y = 0; y < height; y++) {
+		err |= _ili9341_send_payload(desc, data, row_len);
+		if (err < 0) {
+			return ILI9341_PERF_API_END(desc, ILI9341_API_BLIT_RGB565, err);
+		}
+		data += stride;
+	}
+
+	return ILI9341_PERF_API_END(desc, ILI9341_API_BLIT_RGB565, err);
+}
+
+int ili9341_draw_stream(const ili9341_desc_ptr_t desc, uint32_t size, ili9341_stream_producer_t producer, void* ctx) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_DRAW_STREAM);
+	if (producer == NULL) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_DRAW_STREAM, -ILI9341_ERR_INV_PARAM);
+	}
+
+	int err = _ili9341_stream(desc, size, producer, ctx);
+	return ILI9341_PERF_API_END(desc, ILI9341_API_DRAW_STREAM, err);
+}
+
+int ili9341_draw_pixels(const ili9341_desc_ptr_t desc, const uint16_t* pixels, uint32_t count) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_DRAW_PIXELS);
+	int err = ILI9341_SUCCESS;
+
+	if (pixels == NULL) {
+		return ILI9341_PERF_API_END(desc, ILI9341_API_DRAW_PIXELS, -ILI9341_ERR_INV_PARAM);
+	}
+
+	if (desc->pixel_size == 3) {
+		ili9341_blit_src_t src = {(const uint8_t*)pixels, count * 2, count * 2, true};
+		err = _ili9341_stream(desc, count * 3, _ili9341_expand_rows, &src);
+	} else {
+		err = _ili9341_stream(desc, count * 2, _ili9341_swap_pixels, (void*)pixels);
+	}
+
+	return ILI9341_PERF_API_END(desc, ILI9341_API_DRAW_PIXELS, err);
+}
+
+void ili9341_spi_tx_done_cb(const ili9341_desc_ptr_t desc) {
+	/* The init sequence polls the ready flag and advances the queue itself. */
+	if (!_ili9341_is_async(desc)) {
+		return;
+	}
+	if (desc->txq_busy) {
+		_ili9341_txq_advance(desc);
+	}
+	if (desc->wait_signal != NULL) {
+		desc->wait_signal();
+	}
+}
+
+int ili9341_wait_idle(const ili9341_desc_ptr_t desc) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_WAIT_IDLE);
+	int err = ILI9341_SUCCESS;
+
+	if (_ili9341_is_async(desc) && _ili9341_wait(desc, ILI9341_WAIT_FOR_SIGNAL, _ili9341_is_txq_idle, 0) < 0) {
+		_ili9341_lock(desc);
+		_ili9341_txq_abort(desc);
+		_ili9341_unlock(desc);
+		return ILI9341_PERF_API_END(desc, ILI9341_API_WAIT_IDLE, -ILI9341_ERR_COMM_TIMEOUT);
+	}
+
+	_ili9341_lock(desc);
+	err = desc->txq_err;
+	desc->txq_err = ILI9341_SUCCESS;
+	_ili9341_unlock(desc);
+
+	return ILI9341_PERF_API_END(desc, ILI9341_API_WAIT_IDLE, err);
+}
+
+uint32_t ili9341_fence(const ili9341_desc_ptr_t desc) {
+	return desc->txq_pushed;
+}
+
+int ili9341_wait_fence(const ili9341_desc_ptr_t desc, uint32_t fence) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_WAIT_FENCE);
+	int err = _ili9341_wait(desc, ILI9341_WAIT_FOR_SIGNAL, _ili9341_is_fence_done, fence);
+	return ILI9341_PERF_API_END(desc, ILI9341_API_WAIT_FENCE, err);
+}
+
+bool ili9341_is_busy(const ili9341_desc_ptr_t desc) {
+	return desc->txq_busy;
+}
+
+int ili9341_send_txn(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn) {
+	if (txn->params_len > ILI9341_TXN_MAX_PARAMS ||
+			(txn->flags & (ILI9341_TXN_FLAG_REPEAT | ILI9341_TXN_FLAG_SEGMENTS)) != 0) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+
+	if (!(txn->flags & ILI9341_TXN_FLAG_NO_CMD)) {
+		desc->shadow_valid = 0;
+		desc->region_seg_left = UINT32_MAX;
+	}
+
+	return _ili9341_txq_push(desc, txn, ILI9341_STAGE_NONE);
+}
+
+void ili9341_set_txn_observer(const ili9341_desc_ptr_t desc, ili9341_txn_observer_t observer, void* ctx) {
+	_ili9341_lock(desc);
+	desc->txn_observer = observer;
+	desc->txn_observer_ctx = ctx;
+	_ili9341_unlock(desc);
+}
+
+uint32_t ili9341_get_uptime_ms(const ili9341_desc_ptr_t desc) {
+	return desc->uptime_ms;
 }
 
 uint16_t ili9341_get_screen_width(const ili9341_desc_ptr_t desc) {
@@ -418,3 +1944,16 @@ uint16_t ili9341_get_screen_height(const ili9341_desc_ptr_t desc) {
 	return desc->current_height;
 }
 
+uint8_t ili9341_get_pixel_size(const ili9341_desc_ptr_t desc) {
+	return desc->pixel_size;
+}
+
+void ili9341_color_to_pixel(const ili9341_desc_ptr_t desc, uint16_t color, uint8_t* pixel) {
+	if (desc->pixel_size == 3) {
+		_ili9341_RGB565_to_RGB666(color, pixel);
+	} else {
+		pixel[0] = (color >> 8) & 0xFF;
+		pixel[1] = color & 0xFF;
+	}
+}
+
@@ -22,7 +22,20 @@
 
 #include "ili9341_hw_cfg.h"
 
+#ifndef ILI9341_MAX_DRIVERS_CNT
 #define ILI9341_MAX_DRIVERS_CNT       (2)  /**< Maximal number of driver instances (displays attached). */
+#endif
+#define ILI9341_TXQ_LEN               (16) /**< Number of bus transactions that can be queued per display. */
+#define ILI9341_TXN_MAX_PARAMS        (16) /**< Maximal number of command parameter bytes in one transaction. */
+#define ILI9341_GRAM_LINES            (320) /**< Number of frame memory lines, the length of the scrolling axis. */
+#define ILI9341_STAGING_BUF_CNT       (2)  /**< Number of per-display staging buffers streamed in turns. */
+#define ILI9341_STAGING_BUF_SIZE      (1024) /**< Size of one staging buffer in bytes, must be even. */
+#define ILI9341_SEG_TABLE_CNT         (2)  /**< Number of per-display segment tables used in turns. */
+#define ILI9341_SEG_TABLE_LEN         (32) /**< Maximal number of segments in one transaction. */
+
+#ifndef ILI9341_PERF
+#define ILI9341_PERF                  (0)  /**< 1 to build in the performance counters and trace hooks. */
+#endif
 
 /* Colors */
 
@@ -66,6 +79,42 @@ typedef enum {
 	ILI9341_PIN_SET = 1
 } ili9341_gpio_pin_value_t;
 
+#define ILI9341_TXN_FLAG_NO_CMD 0x01	/**< Transaction continues the previous command, no command byte is sent. */
+#define ILI9341_TXN_FLAG_REPEAT 0x02	/**< Payload is a pattern of ILI9341_REPEAT_PATTERN_LEN bytes repeated to payload_len bytes. */
+#define ILI9341_TXN_FLAG_SEGMENTS 0x04	/**< Payload of payload_len bytes is gathered from seg_cnt segments in segs, payload is unused. */
+
+#define ILI9341_PIXFMT_16BIT (0x55)	/**< pixfmt value for 16-bit RGB565 pixels, 2 bytes per pixel. */
+#define ILI9341_PIXFMT_18BIT (0x66)	/**< pixfmt value for 18-bit RGB666 pixels, 3 bytes per pixel. */
+#define ILI9341_PIXFMT_18BIT_DBI (0x06)	/**< pixfmt dbi field value of the 18-bit format. */
+
+#define ILI9341_REPEAT_PATTERN_LEN (2)	/**< Length of the pattern repeated by spi_tx_repeat, one RGB565 pixel. */
+
+/**
+ * Payload segment, a contiguous piece of data sent by one DMA descriptor.
+ */
+typedef struct ili9341_seg_st {
+	const uint8_t* data;	/**< Segment data */
+	uint32_t len;	/**< Segment length in bytes */
+} ili9341_seg_t;
+
+/**
+ * Single bus transaction - command byte, its parameters and optional payload.
+ *
+ * On the bus, the command byte is sent with DC low, then parameters and payload
+ * with DC high, all within one CS low period. When ILI9341_TXN_FLAG_NO_CMD is
+ * set, the transaction carries only data continuing the previous command.
+ */
+typedef struct ili9341_txn_st {
+	uint8_t cmd;	/**< Command code, see ili9341_spi_cmds.h */
+	uint8_t flags;	/**< ILI9341_TXN_FLAG_* flags */
+	uint8_t params_len;	/**< Number of valid bytes in params */
+	uint8_t params[ILI9341_TXN_MAX_PARAMS];	/**< Command parameters */
+	const uint8_t* payload;	/**< Data sent after the parameters, may be NULL */
+	uint32_t payload_len;	/**< Payload length in bytes */
+	const ili9341_seg_t* segs;	/**< Payload segments when ILI9341_TXN_FLAG_SEGMENTS is set */
+	uint16_t seg_cnt;	/**< Number of payload segments */
+} ili9341_txn_t;
+
 /* Hardware interface */
 /**
  *	Wrapper for custom implementation of SPI TX over DMA.
@@ -83,6 +132,49 @@ typedef int (*spi_tx_dma_t)(const uint8_t* data, uint32_t length);
  */
 typedef bool (*spi_tx_dma_ready_t) (void);
 
+/**
+ *	Wrapper for custom implementation of a whole bus transaction.
+ *
+ *	Alternative to spi_tx_dma, cs_pin and dc_pin for platforms that can drive
+ *	CS and DC by hardware or chain DMA descriptors. The function starts the
+ *	transfer of the command, parameters and payload and returns. The end of the
+ *	transaction is reported by spi_tx_ready or ili9341_spi_tx_done_cb the same
+ *	way as for spi_tx_dma. The transaction structure is valid until then.
+ *
+ *	@param [in] txn Transaction to be transfered.
+ *	@returns 0 on success, or negative error code.
+ */
+typedef int (*spi_tx_txn_t)(const ili9341_txn_t* txn);
+
+/**
+ *	Wrapper for custom implementation of SPI TX over DMA from constant source.
+ *
+ *	Optional. Transfers the ILI9341_REPEAT_PATTERN_LEN bytes long pattern count
+ *	times, typically by DMA with memory increment disabled. Completion is reported
+ *	the same way as for spi_tx_dma. When registered together with spi_tx_txn,
+ *	spi_tx_txn must handle transactions with ILI9341_TXN_FLAG_REPEAT as well.
+ *
+ *	@param [in] pattern Pointer to the pattern, valid until the transfer completes.
+ *	@param [in] count Number of pattern repetitions.
+ *	@returns 0 on success, or negative error code.
+ */
+typedef int (*spi_tx_repeat_t)(const uint8_t* pattern, uint32_t count);
+
+/**
+ *	Wrapper for custom implementation of scatter-gather SPI TX over DMA.
+ *
+ *	Optional. Transfers the segments one after another as one DMA request,
+ *	typically by a chain of linked DMA descriptors. Completion is reported the
+ *	same way as for spi_tx_dma, once for the whole chain. When registered
+ *	together with spi_tx_txn, spi_tx_txn must handle transactions with
+ *	ILI9341_TXN_FLAG_SEGMENTS as well.
+ *
+ *	@param [in] segs Segments to be transfered, valid until the transfer completes.
+ *	@param [in] cnt Number of segments.
+ *	@returns 0 on success, or negative error code.
+ */
+typedef int (*spi_tx_dma_sg_t)(const ili9341_seg_t* segs, uint16_t cnt);
+
 /**
  *	Wrapper for custom implementation GPIO RST pin write.
  *
@@ -104,6 +196,165 @@ typedef void (*gpio_cs_pin_t)(ili9341_gpio_pin_value_t value);
  */
 typedef void (*gpio_dc_pin_t)(ili9341_gpio_pin_value_t value);
 
+/**
+ *	Wrapper for custom implementation of entering a critical section.
+ *
+ *	Used to guard the transaction queue against ili9341_spi_tx_done_cb called
+ *	from interrupt, typically by disabling the DMA complete interrupt.
+ */
+typedef void (*irq_lock_t)(void);
+
+/**
+ *	Wrapper for custom implementation of leaving a critical section.
+ */
+typedef void (*irq_unlock_t)(void);
+
+/**
+ *	Wrapper for custom implementation of giving the CPU to other tasks,
+ *	e.g. taskYIELD, used by ILI9341_WAIT_YIELD.
+ */
+typedef void (*wait_yield_t)(void);
+
+/**
+ *	Wrapper for custom implementation of sleeping, e.g. vTaskDelay, used by
+ *	ILI9341_WAIT_SLEEP.
+ *
+ *	@param [in] ms Time to the deadline in milliseconds, waking up earlier is fine.
+ */
+typedef void (*wait_sleep_t)(uint32_t ms);
+
+/**
+ *	Wrapper for custom implementation of blocking until wait_signal is called
+ *	or the time elapses, e.g. taking a binary semaphore, used by
+ *	ILI9341_WAIT_EVENT. A signal given before the call must not get lost.
+ *
+ *	@param [in] ms Time to the deadline in milliseconds.
+ */
+typedef void (*wait_event_t)(uint32_t ms);
+
+/**
+ *	Wrapper for custom implementation of waking up wait_event, e.g. giving
+ *	the semaphore from interrupt. Called from ili9341_spi_tx_done_cb and
+ *	ili9341_te_cb.
+ */
+typedef void (*wait_signal_t)(void);
+
+/**
+ * Producer of streamed pixel data.
+ *
+ * Fills len bytes of the staging buffer with the payload data starting at
+ * the given offset of the whole stream.
+ *
+ * @param [in] ctx User context passed to ili9341_draw_stream.
+ * @param [out] buf Staging buffer.
+ * @param [in] offset Offset of the first byte in the stream.
+ * @param [in] len Number of bytes to fill.
+ */
+typedef void (*ili9341_stream_producer_t)(void* ctx, uint8_t* buf, uint32_t offset, uint32_t len);
+
+/**
+ * Driver calls timed by the performance counters.
+ *
+ * Every call that talks to the display is timed, including the entry points
+ * of the modules built on the driver. Calls that only update memory, like
+ * ili9341_fb8_set_pixel or ili9341_damage_add, and the getters are not.
+ */
+typedef enum {
+	ILI9341_API_INIT,
+	ILI9341_API_INIT_START,
+	ILI9341_API_INIT_POLL,
+	ILI9341_API_SET_ORIENTATION,
+	ILI9341_API_SET_REGION,
+	ILI9341_API_FILL_REGION,
+	ILI9341_API_FILL_PIXELS,
+	ILI9341_API_DRAW_RGB565,
+	ILI9341_API_DRAW_RGB666,
+	ILI9341_API_DRAW_STREAM,
+	ILI9341_API_DRAW_PIXELS,
+	ILI9341_API_BLIT_RGB565,
+	ILI9341_API_SCROLL_SETUP,
+	ILI9341_API_SCROLL,	/**< ili9341_scroll_set, called by the other scrolling methods. */
+	ILI9341_API_PARTIAL_ON,
+	ILI9341_API_PARTIAL_OFF,
+	ILI9341_API_TE_ENABLE,
+	ILI9341_API_TE_DISABLE,
+	ILI9341_API_TE_WAIT_LINE,
+	ILI9341_API_TE_PRESENT,
+	ILI9341_API_WAIT_IDLE,
+	ILI9341_API_WAIT_FENCE,
+	ILI9341_API_BLIT_RGB888,	/**< ili9341_color.h */
+	ILI9341_API_BLIT_ARGB8888,	/**< ili9341_color.h */
+	ILI9341_API_BLIT_INDEXED,	/**< ili9341_color.h */
+	ILI9341_API_BLIT_MONO,	/**< ili9341_color.h */
+	ILI9341_API_DRAW_IMAGE,	/**< ili9341_image.h */
+	ILI9341_API_FB8_FLUSH,	/**< ili9341_fb8.h */
+	ILI9341_API_DAMAGE_FLUSH,	/**< ili9341_damage.h */
+	ILI9341_API_STRIP_RENDER,	/**< ili9341_strip.h */
+	ILI9341_API_REC_REPLAY,	/**< ili9341_rec.h */
+	ILI9341_API_CNT	/**< Number of timed calls, not a call. */
+} ili9341_api_t;
+
+/**
+ * Kind of a traced span.
+ */
+typedef enum {
+	ILI9341_TRACE_API,	/**< Driver call, id is ili9341_api_t. */
+	ILI9341_TRACE_TXN,	/**< Bus transaction, id is the command code, ILI9341_CMD_NOP for data continuing the previous command. */
+} ili9341_trace_kind_t;
+
+/**
+ * Trace hook called at the begin or the end of a traced span.
+ *
+ * Transaction spans are reported from ili9341_spi_tx_done_cb, so in dma_async
+ * mode the hook runs in the DMA interrupt.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] kind Kind of the span.
+ * @param [in] id Span identifier, depends on the kind.
+ */
+typedef void (*ili9341_trace_cb_t)(ili9341_desc_ptr_t desc, ili9341_trace_kind_t kind, uint32_t id);
+
+/**
+ * Observer of the transactions queued to the bus, see ili9341_set_txn_observer.
+ *
+ * Called in the order the transactions are queued, from the caller context of
+ * the driver call, before the transaction is sent. The payload and the
+ * segments of the transaction are valid during the call only.
+ *
+ * @param [in] ctx User context passed to ili9341_set_txn_observer.
+ * @param [in] txn Queued transaction.
+ */
+typedef void (*ili9341_txn_observer_t)(void* ctx, const ili9341_txn_t* txn);
+
+/**
+ * Performance counters of a display, see ili9341_perf_snapshot.
+ */
+typedef struct ili9341_perf_st {
+	uint32_t bytes_sent;	/**< Command, parameter and payload bytes. */
+	uint32_t transactions;	/**< Bus transactions. */
+	uint32_t commands[256];	/**< Transactions by command code, data continuing the previous command counts as ILI9341_CMD_NOP. */
+	uint32_t wait_ms;	/**< Time spent waiting for the SPI ready flag, queue entries, staging buffers, segment tables, idle bus, fences and tearing effect. */
+	uint32_t wait_polls;	/**< Polls of the SPI ready flag. */
+	uint32_t timeouts;	/**< Communication timeouts. */
+	uint32_t api_calls[ILI9341_API_CNT];	/**< Number of calls. */
+	uint32_t api_max_ms[ILI9341_API_CNT];	/**< Longest call in milliseconds. */
+} ili9341_perf_t;
+
+/**
+ * How the driver waits for the bus, the staging buffers, the tearing effect
+ * and the power ON delays.
+ *
+ * Waits for the SPI ready flag are short polls, they call wait_yield in all
+ * strategies but ILI9341_WAIT_SPIN, so all of them require it.
+ * The timeouts are counted by ili9341_1ms_timer_cb in all strategies.
+ */
+typedef enum {
+	ILI9341_WAIT_SPIN = 0,	/**< Busy loop, the default. */
+	ILI9341_WAIT_YIELD,	/**< Call wait_yield in the loop. */
+	ILI9341_WAIT_SLEEP,	/**< Call wait_sleep, until the deadline for delays, for a tick when waiting for the DMA or the tearing effect. */
+	ILI9341_WAIT_EVENT,	/**< Call wait_event until the deadline, woken up by wait_signal on DMA complete and tearing effect. */
+} ili9341_wait_strategy_t;
+
 /**
  * Display driver configuration.
  */
@@ -119,6 +370,17 @@ typedef struct ili9341_cfg_st {
 	uint32_t timeout_ms;	/**< Communication timeout */
 	uint32_t restart_delay_ms;	/**< Delay after software reset */
 	uint32_t wup_delay_ms;	/**< Delay after wakeup command */
+	spi_tx_txn_t spi_tx_txn;	/**< Optional transaction level SPI TX wrapper function, replaces spi_tx_dma, cs_pin and dc_pin */
+	spi_tx_repeat_t spi_tx_repeat;	/**< Optional constant source SPI TX DMA wrapper function, used for solid fills */
+	spi_tx_dma_sg_t spi_tx_dma_sg;	/**< Optional scatter-gather SPI TX DMA wrapper function, used for fills and blits */
+	bool dma_async;	/**< true when the platform calls ili9341_spi_tx_done_cb on DMA completion */
+	irq_lock_t irq_lock;	/**< User defined critical section enter function, may be NULL in synchronous mode */
+	irq_unlock_t irq_unlock;	/**< User defined critical section leave function, may be NULL in synchronous mode */
+	ili9341_wait_strategy_t wait_strategy;	/**< Wait strategy, ILI9341_WAIT_SPIN when zeroed */
+	wait_yield_t wait_yield;	/**< User defined yield function, required by all strategies but ILI9341_WAIT_SPIN */
+	wait_sleep_t wait_sleep;	/**< User defined sleep function, required by ILI9341_WAIT_SLEEP */
+	wait_event_t wait_event;	/**< User defined wait for event function, required by ILI9341_WAIT_EVENT */
+	wait_signal_t wait_signal;	/**< User defined event signal function, required by ILI9341_WAIT_EVENT */
 } ili9341_cfg_t;
 
 /**
@@ -179,10 +441,47 @@ ili9341_hw_cfg_t ili9341_get_default_hw_cfg();
  */
 ili9341_desc_ptr_t ili9341_init(const ili9341_cfg_t* cfg, const ili9341_hw_cfg_t* hw_cfg);
 
+/**
+ * Start non-blocking instantiation of a new ILI9341 display driver.
+ *
+ * Same as ili9341_init, but only allocates the driver instance and returns.
+ * The power ON sequence, including the restart and wakeup delays, is then
+ * advanced by ili9341_init_poll, so several displays can be brought up at once
+ * and the application can do other work during the delays.
+ *
+ * @param [in] cfg The display driver configuration.
+ * @param [in] hw_cfg Configuration of the ILI9341 display driver, must stay
+ * valid until ili9341_init_done returns true.
+ *
+ * @returns display driver instance to be polled or NULL in case of error.
+ */
+ili9341_desc_ptr_t ili9341_init_start(const ili9341_cfg_t* cfg, const ili9341_hw_cfg_t* hw_cfg);
+
+/**
+ * Advance the power ON sequence started by ili9341_init_start.
+ *
+ * Sends the commands due and returns, never waits for the delays. Call it
+ * repeatedly until ili9341_init_done returns true. No other driver function
+ * may be used on the instance before that.
+ *
+ * @param [in] desc Display driver instance.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_init_poll(const ili9341_desc_ptr_t desc);
+
+/**
+ * Check if the power ON sequence is complete.
+ *
+ * @param [in] desc Display driver instance.
+ * @returns true when the display is initialized and ready to use.
+ */
+bool ili9341_init_done(const ili9341_desc_ptr_t desc);
+
 /**
  * Set display orientation.
  *
- * This method configures the MADCTL to match the given orientation.
+ * This method configures the MADCTL to match the given orientation. Nothing is sent
+ * when the display already is in the requested orientation.
  *
  * @param [in] desc Display driver instance.
  * @param [in] orientation Required display orientation.
@@ -194,6 +493,8 @@ int ili9341_set_orientation(const ili9341_desc_ptr_t desc, ili9341_orientation_t
  * Set region to put image data to.
  *
  * This method sets CASET and PASET registers to given area. Display is then ready to accept image data.
+ * Registers already holding the requested value are not resent, so moving a region
+ * along one axis only updates CASET or PASET.
  *
  * @param [in] desc Display driver instance.
  * @param [in] top_left Top left corner of the area.
@@ -213,11 +514,26 @@ int ili9341_set_region(const ili9341_desc_ptr_t desc, coord_2d_t top_left, coord
  */
 int ili9341_fill_region(const ili9341_desc_ptr_t desc, uint16_t color);
 
+/**
+ * Draw pixels of a solid color.
+ *
+ * Continues the drawing into the display region like ili9341_draw_RGB565_dma,
+ * so solid runs can be mixed with image data, e.g. by image decoders. Sent as
+ * one constant source transfer when spi_tx_repeat is available.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] color Color of the pixels.
+ * @param [in] size Number of pixels.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_fill_pixels(const ili9341_desc_ptr_t desc, uint16_t color, uint32_t size);
+
 /**
  * Draw RGB565 color format image into display region.
  *
  * This method sends RAW data of RGP565 image into display region defined by ili9341_set_region.
  * The display region size must match the image size, otherwise it will be deformed or truncated.
+ * In 18-bit pixel format the image is converted to RGB666 through the staging buffers.
  *
  * @param [in] desc Display driver instance.
  * @param [in] data RGB565 image data.
@@ -226,6 +542,294 @@ int ili9341_fill_region(const ili9341_desc_ptr_t desc, uint16_t color);
  */
 int ili9341_draw_RGB565_dma(const ili9341_desc_ptr_t desc, const uint8_t* data, uint32_t size);
 
+/**
+ * Draw RGB666 color format image into display region.
+ *
+ * Sends the image as is, 3 bytes per pixel with the R, G and B channels in the
+ * upper 6 bits of the bytes. Available in 18-bit pixel format only.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] data RGB666 image data.
+ * @param [in] size Size of the image in bytes.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_draw_RGB666_dma(const ili9341_desc_ptr_t desc, const uint8_t* data, uint32_t size);
+
+/**
+ * Draw a rectangle cut out of a larger RGB565 image.
+ *
+ * Sets the display region of the given size at top_left and sends the rows of
+ * the source, in the format of ili9341_draw_RGB565_dma, straight from the image
+ * without copying them to a temporary buffer first. Only short rows are
+ * gathered into the staging buffers to save transfers. In dma_async mode the
+ * image must stay valid until ili9341_wait_idle returns.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] top_left Top left corner of the display area.
+ * @param [in] data First pixel of the rectangle in the source image.
+ * @param [in] stride Length of one source image line in bytes.
+ * @param [in] width Width of the rectangle in pixels.
+ * @param [in] height Height of the rectangle in pixels.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_blit_RGB565(const ili9341_desc_ptr_t desc, coord_2d_t top_left, const uint8_t* data,
+		uint32_t stride, uint16_t width, uint16_t height);
+
+/**
+ * Draw native RGB565 pixels into display region.
+ *
+ * Same as ili9341_draw_RGB565_dma, but takes the pixels as uint16_t values in
+ * the CPU byte order. They are byte swapped chunk by chunk into the staging
+ * buffers while the previous chunk is being sent, with or without dma_async,
+ * so the pixel data needs no separate swapping pass and may be reused as soon
+ * as the function returns.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] pixels RGB565 pixels.
+ * @param [in] count Number of pixels.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_draw_pixels(const ili9341_desc_ptr_t desc, const uint16_t* pixels, uint32_t count);
+
+/**
+ * Draw data generated on the fly into display region.
+ *
+ * The producer fills the staging buffers chunk by chunk, each chunk is
+ * produced while the previous one is being sent, with or without dma_async.
+ * Without it, the function returns after the last chunk is sent. Chunks hold whole pixels
+ * of ili9341_get_pixel_size bytes. Used for pixel format
+ * conversions and decoders that need no full frame buffer.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] size Size of the data in bytes.
+ * @param [in] producer Data producer.
+ * @param [in] ctx User context passed to the producer.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_draw_stream(const ili9341_desc_ptr_t desc, uint32_t size, ili9341_stream_producer_t producer, void* ctx);
+
+/**
+ * Notify the driver that the SPI DMA transfer has finished.
+ *
+ * Call this function from your SPI TX DMA complete interrupt when the display
+ * was configured with dma_async. The driver then starts the next queued transfer
+ * immediately, without the CPU polling for the end of the transfer. Calls
+ * before ili9341_init_done returns true are ignored, the init sequence polls
+ * spi_tx_ready instead.
+ *
+ * @param [in] desc Display driver instance.
+ */
+void ili9341_spi_tx_done_cb(const ili9341_desc_ptr_t desc);
+
+/**
+ * Wait until all queued transfers are sent.
+ *
+ * In dma_async mode the drawing functions only queue the transfers and return.
+ * Data passed to ili9341_draw_RGB565_dma must stay valid until this function returns.
+ *
+ * @param [in] desc Display driver instance.
+ * @returns ILI9341_SUCCESS or negative error code of any failed queued transfer.
+ */
+int ili9341_wait_idle(const ili9341_desc_ptr_t desc);
+
+/**
+ * Set up hardware vertical scrolling.
+ *
+ * Defines fixed areas at the top and bottom of the screen and a scrolling area
+ * between them, scrolled to offset 0. Scrolling runs along the frame memory
+ * lines, so it is vertical in vertical orientations and horizontal in horizontal
+ * ones. Call it again after changing the orientation.
+ *
+ * While scrolling is on, region coordinates are screen coordinates - the driver
+ * translates them to the frame memory lines currently displayed there, so the
+ * drawing functions keep working. In horizontal orientations, a region must not
+ * cross the line where the scrolled content wraps around.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] top_fixed Number of lines of the top fixed area.
+ * @param [in] bottom_fixed Number of lines of the bottom fixed area.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_scroll_setup(const ili9341_desc_ptr_t desc, uint16_t top_fixed, uint16_t bottom_fixed);
+
+/**
+ * Set the scrolling area offset.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] offset Number of lines the content is scrolled up, or left, by.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_scroll_set(const ili9341_desc_ptr_t desc, uint16_t offset);
+
+/**
+ * Scroll the scrolling area content.
+ *
+ * Moves the content by the given number of lines, only the VSCRSADD register
+ * is written. The lines exposed at the end of the scrolling area keep their old
+ * content and are to be redrawn by the application.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] lines Number of lines to scroll up, or left, by. Negative scrolls back.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_scroll(const ili9341_desc_ptr_t desc, int16_t lines);
+
+/**
+ * Stop hardware vertical scrolling and return to normal display mode.
+ *
+ * @param [in] desc Display driver instance.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_scroll_stop(const ili9341_desc_ptr_t desc);
+
+/**
+ * Enter partial display mode.
+ *
+ * Only the panel lines covered by the region are driven, the rest of the
+ * screen shows the non-display area color. Together with reduced frame rate
+ * this lowers the power consumption for low power status screens. In vertical
+ * orientations the partial area is a band of screen lines, in horizontal
+ * orientations a band of screen columns.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] top_left Top left corner of the area to keep displayed.
+ * @param [in] bottom_right Bottom Right corner of the area to keep displayed.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_partial_on(const ili9341_desc_ptr_t desc, coord_2d_t top_left, coord_2d_t bottom_right);
+
+/**
+ * Leave partial display mode and return to normal display mode.
+ *
+ * @param [in] desc Display driver instance.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_partial_off(const ili9341_desc_ptr_t desc);
+
+/**
+ * Enable the tearing effect output line.
+ *
+ * The TE signal is raised when the panel scan reaches the given line, 0 for
+ * the vertical blanking. Call ili9341_te_cb on its rising edge. The frame
+ * period is measured again from the edges coming after the call.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] line Panel scan line to signal.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_te_enable(const ili9341_desc_ptr_t desc, uint16_t line);
+
+/**
+ * Disable the tearing effect output line.
+ *
+ * @param [in] desc Display driver instance.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_te_disable(const ili9341_desc_ptr_t desc);
+
+/**
+ * TE line rising edge callback.
+ *
+ * Call this function from your TE GPIO interrupt. The driver measures the
+ * frame period from the edges to schedule the writes.
+ *
+ * @param [in] desc Display driver instance.
+ */
+void ili9341_te_cb(const ili9341_desc_ptr_t desc);
+
+/**
+ * Wait until the panel scan passes the given line in the next frame.
+ *
+ * The moment is estimated from the next TE edge and the measured frame period,
+ * rounded to be rather later than sooner. Until the period is measured, right
+ * after ili9341_te_enable, it waits for the edge that completes the first
+ * period.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] line Panel scan line.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_te_wait_line(const ili9341_desc_ptr_t desc, uint16_t line);
+
+/**
+ * Draw RGB565 image into display region in sync with the panel scan.
+ *
+ * The write starts right after the panel scan passed the first line of the
+ * region, so the write pointer stays behind the scan line and the region is
+ * never displayed half updated, as long as the write finishes before the next
+ * frame scan gets to it. Use it for animations with TE enabled.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] top_left Top left corner of the area.
+ * @param [in] bottom_right Bottom Right corner of the area.
+ * @param [in] data RGB565 image data.
+ * @param [in] size Size of the image in bytes.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_te_present(const ili9341_desc_ptr_t desc, coord_2d_t top_left, coord_2d_t bottom_right,
+		const uint8_t* data, uint32_t size);
+
+/**
+ * Get a fence of the transfers queued so far.
+ *
+ * Pass the fence to ili9341_wait_fence to wait for the transfers queued before
+ * it, e.g. to reuse a buffer while later transfers are still in flight.
+ *
+ * @param [in] desc Display driver instance.
+ * @returns fence of the last queued transfer.
+ */
+uint32_t ili9341_fence(const ili9341_desc_ptr_t desc);
+
+/**
+ * Wait until all transfers queued before the fence are sent.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] fence Fence returned by ili9341_fence.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_wait_fence(const ili9341_desc_ptr_t desc, uint32_t fence);
+
+/**
+ * Check if there are transfers in progress.
+ *
+ * @param [in] desc Display driver instance.
+ * @returns true when the bus is busy with queued transfers.
+ */
+bool ili9341_is_busy(const ili9341_desc_ptr_t desc);
+
+/**
+ * Queue a raw transaction to the bus.
+ *
+ * The transaction is sent as is, like the ones queued by the driver calls,
+ * e.g. to replay a recorded command stream. The driver does not track the
+ * state the command changes, so the cached column, page and memory access
+ * control registers are invalidated and the next driver call sends them
+ * again. The payload must stay valid until the transaction is sent, see
+ * ili9341_fence.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] txn Transaction, without ILI9341_TXN_FLAG_REPEAT and ILI9341_TXN_FLAG_SEGMENTS.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_send_txn(const ili9341_desc_ptr_t desc, const ili9341_txn_t* txn);
+
+/**
+ * Register an observer of all transactions queued to the bus.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] observer Observer, NULL to unregister.
+ * @param [in] ctx User context passed to the observer.
+ */
+void ili9341_set_txn_observer(const ili9341_desc_ptr_t desc, ili9341_txn_observer_t observer, void* ctx);
+
+/**
+ * Get the time since the driver initialization.
+ *
+ * @param [in] desc Display driver instance.
+ * @returns time in milliseconds counted by ili9341_1ms_timer_cb.
+ */
+uint32_t ili9341_get_uptime_ms(const ili9341_desc_ptr_t desc);
+
 /**
  * Get screen width in pixels
  *
@@ -246,6 +850,87 @@ uint16_t ili9341_get_screen_width(const ili9341_desc_ptr_t desc);
  */
 uint16_t ili9341_get_screen_height(const ili9341_desc_ptr_t desc);
 
+/**
+ * Get the size of one pixel on the bus in bytes.
+ *
+ * 2 in the default 16-bit pixel format, 3 when the display was initialized
+ * with ILI9341_PIXFMT_18BIT in the pixfmt of the chip configuration.
+ *
+ * @param [in] desc Display driver instance.
+ * @returns Pixel size in bytes.
+ */
+uint8_t ili9341_get_pixel_size(const ili9341_desc_ptr_t desc);
+
+/**
+ * Convert RGB565 color to the pixel bytes sent on the bus.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] color RGB565 color.
+ * @param [out] pixel ili9341_get_pixel_size bytes of the pixel.
+ */
+void ili9341_color_to_pixel(const ili9341_desc_ptr_t desc, uint16_t color, uint8_t* pixel);
+
+/**
+ * Take a snapshot of the performance counters.
+ *
+ * The counters exist only when the driver is built with ILI9341_PERF set to
+ * 1, otherwise they are compiled out entirely and the snapshot fails. Times
+ * have the resolution of ili9341_1ms_timer_cb.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [out] perf Counters since init or the last reset.
+ * @returns ILI9341_SUCCESS or -ILI9341_ERR_INV_PARAM when the counters are not built in.
+ */
+int ili9341_perf_snapshot(const ili9341_desc_ptr_t desc, ili9341_perf_t* perf);
+
+/**
+ * Reset the performance counters.
+ *
+ * @param [in] desc Display driver instance.
+ */
+void ili9341_perf_reset(const ili9341_desc_ptr_t desc);
+
+/**
+ * Register trace hooks called around every timed driver call and every bus
+ * transaction. Needs ILI9341_PERF set to 1 like the counters.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] begin Hook called when a span begins, may be NULL.
+ * @param [in] end Hook called when a span ends, may be NULL.
+ * @returns ILI9341_SUCCESS or -ILI9341_ERR_INV_PARAM when the hooks are not built in.
+ */
+int ili9341_perf_set_trace(const ili9341_desc_ptr_t desc, ili9341_trace_cb_t begin, ili9341_trace_cb_t end);
+
+#if ILI9341_PERF
+/**
+ * Begin a timed driver call, use ILI9341_PERF_API_BEGIN instead.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] api Timed call.
+ * @returns uptime at the begin, for ili9341_perf_api_end.
+ */
+uint32_t ili9341_perf_api_begin(const ili9341_desc_ptr_t desc, ili9341_api_t api);
+
+/**
+ * End a timed driver call, use ILI9341_PERF_API_END instead.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] api Timed call.
+ * @param [in] start_ms Uptime returned by ili9341_perf_api_begin.
+ * @param [in] err Result of the call.
+ * @returns err
+ */
+int ili9341_perf_api_end(const ili9341_desc_ptr_t desc, ili9341_api_t api, uint32_t start_ms, int err);
+
+/** Start timing a driver call, the first statement of the call. */
+#define ILI9341_PERF_API_BEGIN(desc, api) uint32_t perf_start_ms = ili9341_perf_api_begin((desc), (api))
+/** Stop timing a driver call, evaluates to err, for every return of the call. */
+#define ILI9341_PERF_API_END(desc, api, err) ili9341_perf_api_end((desc), (api), perf_start_ms, (err))
+#else
+#define ILI9341_PERF_API_BEGIN(desc, api) ((void)0)
+#define ILI9341_PERF_API_END(desc, api, err) (err)
+#endif
+
 /**
  * 1MS timer callback.
  *
@@ -253,5 +938,15 @@ uint16_t ili9341_get_screen_height(const ili9341_desc_ptr_t desc);
  */
 void ili9341_1ms_timer_cb();
 
+/**
+ * 1MS timer callback of one display.
+ *
+ * Like ili9341_1ms_timer_cb, for displays with time bases of their own, e.g.
+ * emulated ones. Never call both for the same display.
+ *
+ * @param [in] desc Display driver instance.
+ */
+void ili9341_1ms_tick(const ili9341_desc_ptr_t desc);
+
 
 #endif /* ILI9341_ILI9341_H_ */
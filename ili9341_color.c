@@ -0,0 +1,323 @@
+/*
+ * Color format conversions for ILI9341 driver
+ *
+ * Author: Michal Horn
+ */
+
+#include "ili9341_color.h"
+#include "string.h"
+
+/**
+ * Converts a run of source pixels starting at screen column x, d5 and d6 are
+ * the lines of the dither matrices.
+ */
+typedef void (*ili9341_color_row_t)(uint8_t* out, const uint8_t* in, uint32_t cnt, uint16_t x,
+		const uint8_t* d5, const uint8_t* d6);
+
+/**
+ * Image rectangle converted by the stream producers.
+ */
+typedef struct {
+	const uint8_t* data;
+	uint32_t stride;
+	uint16_t width;
+	coord_2d_t top_left;
+	uint8_t flags;
+	uint8_t src_bpp;	/**< Source pixel size in bytes. */
+	uint8_t out_bpp;	/**< Display pixel size in bytes. */
+	ili9341_color_row_t row;	/**< Row conversion kernel for the source and display formats. */
+} ili9341_color_src_t;
+
+/**
+ * Indexed bitmap rectangle expanded by the stream producer.
+ */
+typedef struct {
+	const uint8_t* data;
+	uint32_t stride;
+	uint16_t width;
+	uint8_t bpp;	/**< Source bits per pixel. */
+	uint8_t out_bpp;	/**< Display pixel size in bytes. */
+	uint8_t lut[256 * 3];	/**< Palette converted to display pixels. */
+} ili9341_index_src_t;
+
+/**
+ * 4x4 Bayer matrix of thresholds 0 to 15 scaled by the right shift to the
+ * quantization step of 16 >> shift.
+ */
+#define ILI9341_BAYER4(shift) { \
+	{0 >> (shift), 8 >> (shift), 2 >> (shift), 10 >> (shift)}, \
+	{12 >> (shift), 4 >> (shift), 14 >> (shift), 6 >> (shift)}, \
+	{3 >> (shift), 11 >> (shift), 1 >> (shift), 9 >> (shift)}, \
+	{15 >> (shift), 7 >> (shift), 13 >> (shift), 5 >> (shift)}, \
+}
+
+/**
+ * 4x4 Bayer matrix scaled to the quantization step of 8 of 5-bit channels.
+ */
+static const uint8_t ili9341_dither5[4][4] = ILI9341_BAYER4(1);
+
+/**
+ * 4x4 Bayer matrix scaled to the quantization step of 4 of 6-bit channels.
+ * The step has 4 thresholds only, the shift leaves the 2x2 Bayer matrix the
+ * 4x4 one is built of, so the pattern repeats every 2 pixels.
+ */
+static const uint8_t ili9341_dither6[4][4] = ILI9341_BAYER4(2);
+
+static const uint8_t ili9341_dither_none[4] = {0, 0, 0, 0};
+
+/* Private methods. */
+
+uint8_t _ili9341_color_sat_add(uint8_t v, uint8_t d) {
+	uint16_t sum = (uint16_t)v + d;
+	return (sum > 0xFF) ? 0xFF : (uint8_t)sum;
+}
+
+/*
+ * Convert a run of RGB888 pixels to big endian RGB565. d5 and d6 are the rows
+ * of the dither matrices for the line, indexed by the screen x.
+ */
+void _ili9341_color_row_rgb888(uint8_t* out, const uint8_t* in, uint32_t cnt, uint16_t x,
+		const uint8_t* d5, const uint8_t* d6) {
+	for (uint32_t i = 0; i < cnt; i++, x++, in += 3, out += 2) {
+		uint8_t r = _ili9341_color_sat_add(in[0], d5[x & 3]);
+		uint8_t g = _ili9341_color_sat_add(in[1], d6[x & 3]);
+		uint8_t b = _ili9341_color_sat_add(in[2], d5[x & 3]);
+		out[0] = (r & 0xF8) | (g >> 5);
+		out[1] = ((g << 3) & 0xE0) | (b >> 3);
+	}
+}
+
+/*
+ * Convert a run of native 0xAARRGGBB pixels to big endian RGB565.
+ */
+void _ili9341_color_row_argb8888(uint8_t* out, const uint8_t* in, uint32_t cnt, uint16_t x,
+		const uint8_t* d5, const uint8_t* d6) {
+	for (uint32_t i = 0; i < cnt; i++, x++, in += 4, out += 2) {
+		uint32_t px;
+		memcpy(&px, in, sizeof(px));
+		uint8_t r = _ili9341_color_sat_add((px >> 16) & 0xFF, d5[x & 3]);
+		uint8_t g = _ili9341_color_sat_add((px >> 8) & 0xFF, d6[x & 3]);
+		uint8_t b = _ili9341_color_sat_add(px & 0xFF, d5[x & 3]);
+		out[0] = (r & 0xF8) | (g >> 5);
+		out[1] = ((g << 3) & 0xE0) | (b >> 3);
+	}
+}
+
+/*
+ * Convert a run of RGB888 pixels to RGB666, all channels dithered by d6.
+ */
+void _ili9341_color_row_rgb888_666(uint8_t* out, const uint8_t* in, uint32_t cnt, uint16_t x,
+		const uint8_t* d5, const uint8_t* d6) {
+	(void)d5;
+	for (uint32_t i = 0; i < cnt; i++, x++, in += 3, out += 3) {
+		uint8_t d = d6[x & 3];
+		out[0] = _ili9341_color_sat_add(in[0], d) & 0xFC;
+		out[1] = _ili9341_color_sat_add(in[1], d) & 0xFC;
+		out[2] = _ili9341_color_sat_add(in[2], d) & 0xFC;
+	}
+}
+
+/*
+ * Convert a run of native 0xAARRGGBB pixels to RGB666.
+ */
+void _ili9341_color_row_argb8888_666(uint8_t* out, const uint8_t* in, uint32_t cnt, uint16_t x,
+		const uint8_t* d5, const uint8_t* d6) {
+	(void)d5;
+	for (uint32_t i = 0; i < cnt; i++, x++, in += 4, out += 3) {
+		uint32_t px;
+		uint8_t d = d6[x & 3];
+		memcpy(&px, in, sizeof(px));
+		out[0] = _ili9341_color_sat_add((px >> 16) & 0xFF, d) & 0xFC;
+		out[1] = _ili9341_color_sat_add((px >> 8) & 0xFF, d) & 0xFC;
+		out[2] = _ili9341_color_sat_add(px & 0xFF, d) & 0xFC;
+	}
+}
+
+/*
+ * Produce a chunk of the converted rectangle row run by row run, a chunk may
+ * start and end in the middle of a line.
+ */
+void _ili9341_color_produce(void* ctx, uint8_t* buf, uint32_t offset, uint32_t len) {
+	const ili9341_color_src_t* src = (const ili9341_color_src_t*)ctx;
+	uint32_t pixel = offset / src->out_bpp;
+	uint32_t cnt = len / src->out_bpp;
+	uint16_t x = pixel % src->width;
+	uint32_t y = pixel / src->width;
+
+	while (cnt > 0) {
+		uint32_t run = src->width - x;
+		if (run > cnt) {
+			run = cnt;
+		}
+
+		uint16_t sx = src->top_left.x + x;
+		uint16_t sy = src->top_left.y + y;
+		const uint8_t* d5 = ili9341_dither_none;
+		const uint8_t* d6 = ili9341_dither_none;
+		if (src->flags & ILI9341_COLOR_DITHER) {
+			d5 = ili9341_dither5[sy & 3];
+			d6 = ili9341_dither6[sy & 3];
+		}
+
+		src->row(buf, src->data + y * src->stride + x * src->src_bpp, run, sx, d5, d6);
+		buf += run * src->out_bpp;
+		cnt -= run;
+		x = 0;
+		y++;
+	}
+}
+
+void _ili9341_color_put(uint8_t* out, const uint8_t* pixel, uint8_t out_bpp) {
+	out[0] = pixel[0];
+	out[1] = pixel[1];
+	if (out_bpp == 3) {
+		out[2] = pixel[2];
+	}
+}
+
+/*
+ * Expand a run of indexed pixels starting at column x of the line through the
+ * LUT. Source bytes hold the leftmost pixel in the most significant bits.
+ */
+void _ili9341_color_row_indexed(const ili9341_index_src_t* src, uint8_t* out, const uint8_t* in, uint16_t x, uint32_t cnt) {
+	uint8_t bpp = src->bpp;
+	uint8_t ob = src->out_bpp;
+	uint8_t ppb = 8 / bpp;
+	uint8_t mask = (1 << bpp) - 1;
+	uint8_t sub = x % ppb;
+
+	in += x / ppb;
+	while (cnt > 0) {
+		uint8_t byte = *in++;
+
+		/* Solid bytes of 1-bit bitmaps, the bulk of glyphs and icons. */
+		if (bpp == 1 && sub == 0 && cnt >= 8 && (byte == 0x00 || byte == 0xFF)) {
+			const uint8_t* pixel = &src->lut[(byte & 1) * ob];
+			for (uint8_t i = 0; i < 8; i++, out += ob) {
+				_ili9341_color_put(out, pixel, ob);
+			}
+			cnt -= 8;
+			continue;
+		}
+
+		for (; sub < ppb && cnt > 0; sub++, cnt--, out += ob) {
+			uint8_t idx = (byte >> (8 - bpp * (sub + 1))) & mask;
+			_ili9341_color_put(out, &src->lut[idx * ob], ob);
+		}
+		sub = 0;
+	}
+}
+
+void _ili9341_color_produce_indexed(void* ctx, uint8_t* buf, uint32_t offset, uint32_t len) {
+	const ili9341_index_src_t* src = (const ili9341_index_src_t*)ctx;
+	uint32_t pixel = offset / src->out_bpp;
+	uint32_t cnt = len / src->out_bpp;
+	uint16_t x = pixel % src->width;
+	uint32_t y = pixel / src->width;
+
+	while (cnt > 0) {
+		uint32_t run = src->width - x;
+		if (run > cnt) {
+			run = cnt;
+		}
+
+		_ili9341_color_row_indexed(src, buf, src->data + y * src->stride, x, run);
+		buf += run * src->out_bpp;
+		cnt -= run;
+		x = 0;
+		y++;
+	}
+}
+
+int _ili9341_color_blit_indexed(const ili9341_desc_ptr_t desc, ili9341_index_src_t* src, coord_2d_t top_left, uint16_t height) {
+	int err = ILI9341_SUCCESS;
+
+	if (src->data == NULL || src->width == 0 || height == 0 ||
+			src->stride < ((uint32_t)src->width * src->bpp + 7) / 8) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+
+	coord_2d_t bottom_right = {top_left.x + src->width - 1, top_left.y + height - 1};
+	err |= ili9341_set_region(desc, top_left, bottom_right);
+	if (err < 0) {
+		return err;
+	}
+
+	err |= ili9341_draw_stream(desc, (uint32_t)src->width * height * src->out_bpp, _ili9341_color_produce_indexed, src);
+
+	return err;
+}
+
+int _ili9341_color_blit(const ili9341_desc_ptr_t desc, ili9341_color_src_t* src, uint16_t height) {
+	int err = ILI9341_SUCCESS;
+
+	if (src->data == NULL || src->width == 0 || height == 0 || src->stride < (uint32_t)src->width * src->src_bpp) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+
+	coord_2d_t bottom_right = {src->top_left.x + src->width - 1, src->top_left.y + height - 1};
+	err |= ili9341_set_region(desc, src->top_left, bottom_right);
+	if (err < 0) {
+		return err;
+	}
+
+	err |= ili9341_draw_stream(desc, (uint32_t)src->width * height * src->out_bpp, _ili9341_color_produce, src);
+
+	return err;
+}
+
+int _ili9341_color_blit_palette(const ili9341_desc_ptr_t desc, coord_2d_t top_left, const uint8_t* data,
+		uint32_t stride, uint16_t width, uint16_t height, uint8_t bpp, const uint16_t* palette) {
+	if (palette == NULL || (bpp != 1 && bpp != 2 && bpp != 4 && bpp != 8)) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+
+	ili9341_index_src_t src;
+	src.data = data;
+	src.stride = stride;
+	src.width = width;
+	src.bpp = bpp;
+	src.out_bpp = ili9341_get_pixel_size(desc);
+	for (uint16_t i = 0; i < (1 << bpp); i++) {
+		ili9341_color_to_pixel(desc, palette[i], &src.lut[i * src.out_bpp]);
+	}
+
+	return _ili9341_color_blit_indexed(desc, &src, top_left, height);
+}
+
+/* Public interface methods. */
+
+int ili9341_blit_RGB888(const ili9341_desc_ptr_t desc, coord_2d_t top_left, const uint8_t* data,
+		uint32_t stride, uint16_t width, uint16_t height, uint8_t flags) {
+	uint8_t out_bpp = ili9341_get_pixel_size(desc);
+	ili9341_color_src_t src = {data, stride, width, top_left, flags, 3, out_bpp,
+			(out_bpp == 3) ? _ili9341_color_row_rgb888_666 : _ili9341_color_row_rgb888};
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_BLIT_RGB888);
+	int err = _ili9341_color_blit(desc, &src, height);
+	return ILI9341_PERF_API_END(desc, ILI9341_API_BLIT_RGB888, err);
+}
+
+int ili9341_blit_ARGB8888(const ili9341_desc_ptr_t desc, coord_2d_t top_left, const uint32_t* data,
+		uint32_t stride, uint16_t width, uint16_t height, uint8_t flags) {
+	uint8_t out_bpp = ili9341_get_pixel_size(desc);
+	ili9341_color_src_t src = {(const uint8_t*)data, stride, width, top_left, flags, 4, out_bpp,
+			(out_bpp == 3) ? _ili9341_color_row_argb8888_666 : _ili9341_color_row_argb8888};
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_BLIT_ARGB8888);
+	int err = _ili9341_color_blit(desc, &src, height);
+	return ILI9341_PERF_API_END(desc, ILI9341_API_BLIT_ARGB8888, err);
+}
+
+int ili9341_blit_indexed(const ili9341_desc_ptr_t desc, coord_2d_t top_left, const uint8_t* data,
+		uint32_t stride, uint16_t width, uint16_t height, uint8_t bpp, const uint16_t* palette) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_BLIT_INDEXED);
+	int err = _ili9341_color_blit_palette(desc, top_left, data, stride, width, height, bpp, palette);
+	return ILI9341_PERF_API_END(desc, ILI9341_API_BLIT_INDEXED, err);
+}
+
+int ili9341_blit_mono(const ili9341_desc_ptr_t desc, coord_2d_t top_left, const uint8_t* data,
+		uint32_t stride, uint16_t width, uint16_t height, uint16_t fg, uint16_t bg) {
+	uint16_t palette[2] = {bg, fg};
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_BLIT_MONO);
+	int err = _ili9341_color_blit_palette(desc, top_left, data, stride, width, height, 1, palette);
+	return ILI9341_PERF_API_END(desc, ILI9341_API_BLIT_MONO, err);
+}
@@ -0,0 +1,95 @@
+/*
+ * Color format conversions for ILI9341 driver
+ *
+ * Blits of 24 and 32-bit images and palette indexed bitmaps converted to the
+ * display format on the fly, see README.md.
+ *
+ * Author: Michal Horn
+ */
+
+#ifndef ILI9341_ILI9341_COLOR_H_
+#define ILI9341_ILI9341_COLOR_H_
+
+#include "ili9341.h"
+
+#define ILI9341_COLOR_DITHER          0x01 /**< Apply 4x4 ordered dithering when reducing the color depth. */
+
+/**
+ * Draw a rectangle of an RGB888 image.
+ *
+ * Pixels are stored as R, G, B bytes. They are converted to RGB565, or RGB666
+ * in 18-bit pixel format, chunk by chunk into the staging buffers while the
+ * previous chunk is being sent, so no intermediate frame is needed. With ILI9341_COLOR_DITHER, the 4x4 Bayer
+ * pattern is aligned to the screen, so neighbouring blits match.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] top_left Top left corner of the display area.
+ * @param [in] data First pixel of the rectangle in the source image.
+ * @param [in] stride Length of one source image line in bytes.
+ * @param [in] width Width of the rectangle in pixels.
+ * @param [in] height Height of the rectangle in pixels.
+ * @param [in] flags ILI9341_COLOR_* flags.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_blit_RGB888(const ili9341_desc_ptr_t desc, coord_2d_t top_left, const uint8_t* data,
+		uint32_t stride, uint16_t width, uint16_t height, uint8_t flags);
+
+/**
+ * Draw a rectangle of an ARGB8888 image.
+ *
+ * Same as ili9341_blit_RGB888 for pixels stored as uint32_t 0xAARRGGBB values
+ * in the CPU byte order. Alpha is ignored, the pixels are drawn opaque.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] top_left Top left corner of the display area.
+ * @param [in] data First pixel of the rectangle in the source image.
+ * @param [in] stride Length of one source image line in bytes.
+ * @param [in] width Width of the rectangle in pixels.
+ * @param [in] height Height of the rectangle in pixels.
+ * @param [in] flags ILI9341_COLOR_* flags.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_blit_ARGB8888(const ili9341_desc_ptr_t desc, coord_2d_t top_left, const uint32_t* data,
+		uint32_t stride, uint16_t width, uint16_t height, uint8_t flags);
+
+/**
+ * Draw a rectangle of a palette indexed bitmap.
+ *
+ * Pixels are 1, 2, 4 or 8-bit indices into the palette, packed with the
+ * leftmost pixel in the most significant bits of a byte. Every line starts at
+ * a byte boundary. The palette is converted to display pixels once and the
+ * bitmap is expanded through it chunk by chunk into the staging buffers.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] top_left Top left corner of the display area.
+ * @param [in] data First byte of the bitmap.
+ * @param [in] stride Length of one bitmap line in bytes.
+ * @param [in] width Width of the bitmap in pixels.
+ * @param [in] height Height of the bitmap in pixels.
+ * @param [in] bpp Bits per pixel, 1, 2, 4 or 8.
+ * @param [in] palette 2^bpp RGB565 colors.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_blit_indexed(const ili9341_desc_ptr_t desc, coord_2d_t top_left, const uint8_t* data,
+		uint32_t stride, uint16_t width, uint16_t height, uint8_t bpp, const uint16_t* palette);
+
+/**
+ * Draw a 1-bit bitmap, e.g. a font glyph, in two colors.
+ *
+ * Set bits are drawn in the foreground color, clear bits in the background
+ * color. Bytes of 8 equal pixels are expanded at once.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] top_left Top left corner of the display area.
+ * @param [in] data First byte of the bitmap.
+ * @param [in] stride Length of one bitmap line in bytes.
+ * @param [in] width Width of the bitmap in pixels.
+ * @param [in] height Height of the bitmap in pixels.
+ * @param [in] fg Foreground RGB565 color.
+ * @param [in] bg Background RGB565 color.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_blit_mono(const ili9341_desc_ptr_t desc, coord_2d_t top_left, const uint8_t* data,
+		uint32_t stride, uint16_t width, uint16_t height, uint16_t fg, uint16_t bg);
+
+#endif /* ILI9341_ILI9341_COLOR_H_ */
@@ -0,0 +1,181 @@
+/*
+ * Dirty rectangles tracking for ILI9341 driver
+ *
+ * Author: Michal Horn
+ */
+
+#include "ili9341_damage.h"
+
+#define ILI9341_DAMAGE_BYTES_PER_PIXEL 2	/* Of the RGB565 source framebuffer, the bus may carry 3. */
+
+/* Private methods. */
+
+uint32_t _ili9341_damage_rect_area(const ili9341_rect_t* rect) {
+	return (uint32_t)(rect->bottom_right.x - rect->top_left.x + 1) *
+			(uint32_t)(rect->bottom_right.y - rect->top_left.y + 1);
+}
+
+ili9341_rect_t _ili9341_damage_rect_union(const ili9341_rect_t* r1, const ili9341_rect_t* r2) {
+	ili9341_rect_t u;
+	u.top_left.x = (r1->top_left.x < r2->top_left.x) ? r1->top_left.x : r2->top_left.x;
+	u.top_left.y = (r1->top_left.y < r2->top_left.y) ? r1->top_left.y : r2->top_left.y;
+	u.bottom_right.x = (r1->bottom_right.x > r2->bottom_right.x) ? r1->bottom_right.x : r2->bottom_right.x;
+	u.bottom_right.y = (r1->bottom_right.y > r2->bottom_right.y) ? r1->bottom_right.y : r2->bottom_right.y;
+	return u;
+}
+
+/*
+ * Cost of sending the bounding box instead of the two rectangles separately.
+ * Negative or zero when merging pays off.
+ */
+int32_t _ili9341_damage_merge_gain(const ili9341_damage_t* dmg, const ili9341_rect_t* r1, const ili9341_rect_t* r2) {
+	ili9341_rect_t u = _ili9341_damage_rect_union(r1, r2);
+	uint8_t pixel_size = ili9341_get_pixel_size(dmg->desc);
+	int32_t merged = (int32_t)(_ili9341_damage_rect_area(&u) * pixel_size);
+	int32_t separate = (int32_t)((_ili9341_damage_rect_area(r1) + _ili9341_damage_rect_area(r2)) * pixel_size +
+			dmg->window_cost);
+	return merged - separate;
+}
+
+void _ili9341_damage_remove(ili9341_damage_t* dmg, uint8_t idx) {
+	dmg->rects[idx] = dmg->rects[dmg->rect_cnt - 1];
+	dmg->rect_cnt--;
+}
+
+/*
+ * Find the pair of tracked rectangles whose bounding box costs the least extra.
+ */
+int32_t _ili9341_damage_cheapest_pair(const ili9341_damage_t* dmg, uint8_t* best_i, uint8_t* best_j) {
+	int32_t best_gain = INT32_MAX;
+
+	for (uint8_t i = 0; i < dmg->rect_cnt; i++) {
+		for (uint8_t j = i + 1; j < dmg->rect_cnt; j++) {
+			int32_t gain = _ili9341_damage_merge_gain(dmg, &dmg->rects[i], &dmg->rects[j]);
+			if (gain < best_gain) {
+				best_gain = gain;
+				*best_i = i;
+				*best_j = j;
+			}
+		}
+	}
+
+	return best_gain;
+}
+
+/*
+ * Find the tracked rectangle whose merge with rect costs the least extra.
+ */
+int32_t _ili9341_damage_cheapest_rect(const ili9341_damage_t* dmg, const ili9341_rect_t* rect, uint8_t* best_k) {
+	int32_t best_gain = INT32_MAX;
+
+	for (uint8_t k = 0; k < dmg->rect_cnt; k++) {
+		int32_t gain = _ili9341_damage_merge_gain(dmg, rect, &dmg->rects[k]);
+		if (gain < best_gain) {
+			best_gain = gain;
+			*best_k = k;
+		}
+	}
+
+	return best_gain;
+}
+
+/* Public interface methods. */
+
+int ili9341_damage_init(ili9341_damage_t* dmg, ili9341_desc_ptr_t desc, uint8_t max_rects, uint32_t window_cost) {
+	if (dmg == NULL || desc == NULL || max_rects > ILI9341_DAMAGE_MAX_RECTS) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+
+	dmg->desc = desc;
+	dmg->max_rects = (max_rects == 0) ? ILI9341_DAMAGE_MAX_RECTS : max_rects;
+	dmg->window_cost = (window_cost == 0) ? ILI9341_DAMAGE_WINDOW_COST : window_cost;
+	dmg->rect_cnt = 0;
+	ili9341_damage_reset_stats(dmg);
+
+	return ILI9341_SUCCESS;
+}
+
+void ili9341_damage_add(ili9341_damage_t* dmg, coord_2d_t top_left, coord_2d_t bottom_right) {
+	uint16_t width = ili9341_get_screen_width(dmg->desc);
+	uint16_t height = ili9341_get_screen_height(dmg->desc);
+	ili9341_rect_t rect;
+
+	rect.top_left.x = (top_left.x < bottom_right.x) ? top_left.x : bottom_right.x;
+	rect.top_left.y = (top_left.y < bottom_right.y) ? top_left.y : bottom_right.y;
+	rect.bottom_right.x = (top_left.x < bottom_right.x) ? bottom_right.x : top_left.x;
+	rect.bottom_right.y = (top_left.y < bottom_right.y) ? bottom_right.y : top_left.y;
+
+	if (rect.top_left.x >= width || rect.top_left.y >= height) {
+		return;
+	}
+	if (rect.bottom_right.x >= width) {
+		rect.bottom_right.x = width - 1;
+	}
+	if (rect.bottom_right.y >= height) {
+		rect.bottom_right.y = height - 1;
+	}
+
+	dmg->stats.rects_added++;
+
+	/* Merging grows the rectangle, which may make other merges pay off. */
+	uint8_t k = 0;
+	while (dmg->rect_cnt > 0 && _ili9341_damage_cheapest_rect(dmg, &rect, &k) <= 0) {
+		rect = _ili9341_damage_rect_union(&rect, &dmg->rects[k]);
+		_ili9341_damage_remove(dmg, k);
+	}
+
+	/* Out of slots, make room by the cheapest merge. */
+	if (dmg->rect_cnt >= dmg->max_rects) {
+		uint8_t i = 0, j = 0;
+		int32_t pair_gain = _ili9341_damage_cheapest_pair(dmg, &i, &j);
+		if (_ili9341_damage_cheapest_rect(dmg, &rect, &k) <= pair_gain) {
+			dmg->rects[k] = _ili9341_damage_rect_union(&rect, &dmg->rects[k]);
+			return;
+		}
+		dmg->rects[i] = _ili9341_damage_rect_union(&dmg->rects[i], &dmg->rects[j]);
+		_ili9341_damage_remove(dmg, j);
+	}
+
+	dmg->rects[dmg->rect_cnt++] = rect;
+}
+
+int ili9341_damage_flush(ili9341_damage_t* dmg, const uint8_t* fb, uint32_t stride) {
+	ILI9341_PERF_API_BEGIN(dmg->desc, ILI9341_API_DAMAGE_FLUSH);
+	int err = ILI9341_SUCCESS;
+
+	for (uint8_t i = 0; i < dmg->rect_cnt; i++) {
+		const ili9341_rect_t* rect = &dmg->rects[i];
+		const uint8_t* data = fb + rect->top_left.y * stride + rect->top_left.x * ILI9341_DAMAGE_BYTES_PER_PIXEL;
+
+		err |= ili9341_blit_RGB565(dmg->desc, rect->top_left, data, stride,
+				rect->bottom_right.x - rect->top_left.x + 1, rect->bottom_right.y - rect->top_left.y + 1);
+		if (err < 0) {
+			return ILI9341_PERF_API_END(dmg->desc, ILI9341_API_DAMAGE_FLUSH, err);
+		}
+
+		dmg->stats.windows_sent++;
+		dmg->stats.bytes_sent += _ili9341_damage_rect_area(rect) * ili9341_get_pixel_size(dmg->desc);
+	}
+
+	/* Without damage, a full screen update would not have been sent either. */
+	dmg->stats.flushes++;
+	if (dmg->rect_cnt > 0) {
+		dmg->stats.bytes_full += (uint32_t)ili9341_get_screen_width(dmg->desc) *
+				ili9341_get_screen_height(dmg->desc) * ili9341_get_pixel_size(dmg->desc);
+	}
+	dmg->rect_cnt = 0;
+
+	return ILI9341_PERF_API_END(dmg->desc, ILI9341_API_DAMAGE_FLUSH, err);
+}
+
+ili9341_damage_stats_t ili9341_damage_get_stats(const ili9341_damage_t* dmg) {
+	return dmg->stats;
+}
+
+void ili9341_damage_reset_stats(ili9341_damage_t* dmg) {
+	dmg->stats.flushes = 0;
+	dmg->stats.rects_added = 0;
+	dmg->stats.windows_sent = 0;
+	dmg->stats.bytes_sent = 0;
+	dmg->stats.bytes_full = 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * Dirty rectangles tracking for ILI9341 driver
+ *
+ * Accumulates damaged areas of a host framebuffer and flushes them to the
+ * display as a minimal set of windows, see README.md.
+ *
+ * Author: Michal Horn
+ */
+
+#ifndef ILI9341_ILI9341_DAMAGE_H_
+#define ILI9341_ILI9341_DAMAGE_H_
+
+#include "ili9341.h"
+
+#define ILI9341_DAMAGE_MAX_RECTS      (16) /**< Maximal number of dirty rectangles tracked at once. */
+#define ILI9341_DAMAGE_WINDOW_COST    (64) /**< Default cost of one window setup in bytes of pixel data. */
+
+/**
+ * Rectangle with inclusive corners.
+ */
+typedef struct ili9341_rect_st {
+	coord_2d_t top_left;
+	coord_2d_t bottom_right;
+} ili9341_rect_t;
+
+/**
+ * Dirty rectangles tracker statistics.
+ */
+typedef struct ili9341_damage_stats_st {
+	uint32_t flushes;	/**< Number of flushes. */
+	uint32_t rects_added;	/**< Number of rectangles marked dirty. */
+	uint32_t windows_sent;	/**< Number of windows sent to the display. */
+	uint32_t bytes_sent;	/**< Pixel bytes sent to the display, in its pixel format. */
+	uint32_t bytes_full;	/**< Pixel bytes full screen updates of the flushes with damage would have sent, bytes_full - bytes_sent were saved. */
+} ili9341_damage_stats_t;
+
+/**
+ * Dirty rectangles tracker attached to a display driver instance.
+ *
+ * Allocated by the user, initialized by ili9341_damage_init.
+ */
+typedef struct ili9341_damage_st {
+	ili9341_desc_ptr_t desc;	/**< Display driver instance. */
+	uint8_t max_rects;	/**< Limit of tracked rectangles, at most ILI9341_DAMAGE_MAX_RECTS. */
+	uint8_t rect_cnt;	/**< Number of tracked rectangles. */
+	uint32_t window_cost;	/**< Cost of one window setup in bytes of pixel data. */
+	ili9341_rect_t rects[ILI9341_DAMAGE_MAX_RECTS];	/**< Tracked rectangles. */
+	ili9341_damage_stats_t stats;	/**< Statistics. */
+} ili9341_damage_t;
+
+/**
+ * Initialize the dirty rectangles tracker.
+ *
+ * Rectangles are merged whenever sending their bounding box costs less than
+ * sending them separately. Sending a separate window costs window_cost bytes
+ * on top of the pixel data - the CASET, PASET and RAMWR commands and the
+ * per-transfer overhead of the platform.
+ *
+ * @param [out] dmg Tracker to be initialized.
+ * @param [in] desc Display driver instance.
+ * @param [in] max_rects Limit of tracked rectangles, 0 for ILI9341_DAMAGE_MAX_RECTS.
+ * @param [in] window_cost Cost of one window setup, 0 for ILI9341_DAMAGE_WINDOW_COST.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_damage_init(ili9341_damage_t* dmg, ili9341_desc_ptr_t desc, uint8_t max_rects, uint32_t window_cost);
+
+/**
+ * Mark a rectangle of the framebuffer as dirty.
+ *
+ * The rectangle is clipped to the screen and merged with the tracked ones
+ * when it pays off. When the limit is reached, the cheapest pair is merged.
+ *
+ * @param [in] dmg Dirty rectangles tracker.
+ * @param [in] top_left Top left corner of the area.
+ * @param [in] bottom_right Bottom Right corner of the area.
+ */
+void ili9341_damage_add(ili9341_damage_t* dmg, coord_2d_t top_left, coord_2d_t bottom_right);
+
+/**
+ * Send all dirty rectangles from the framebuffer to the display.
+ *
+ * The framebuffer holds the whole screen in the current orientation as RGB565
+ * data in the format of ili9341_draw_RGB565_dma. In dma_async mode it must not
+ * change until ili9341_wait_idle returns.
+ *
+ * @param [in] dmg Dirty rectangles tracker.
+ * @param [in] fb Framebuffer data.
+ * @param [in] stride Length of one framebuffer line in bytes.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_damage_flush(ili9341_damage_t* dmg, const uint8_t* fb, uint32_t stride);
+
+/**
+ * Get the tracker statistics.
+ *
+ * @param [in] dmg Dirty rectangles tracker.
+ * @returns statistics since init or the last reset.
+ */
+ili9341_damage_stats_t ili9341_damage_get_stats(const ili9341_damage_t* dmg);
+
+/**
+ * Reset the tracker statistics.
+ *
+ * @param [in] dmg Dirty rectangles tracker.
+ */
+void ili9341_damage_reset_stats(ili9341_damage_t* dmg);
+
+#endif /* ILI9341_ILI9341_DAMAGE_H_ */
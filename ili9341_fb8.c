@@ -0,0 +1,157 @@
+/*
+ * Indexed 8-bit framebuffer for ILI9341 driver
+ *
+ * Author: Michal Horn
+ */
+
+#include "ili9341_fb8.h"
+#include "string.h"
+
+/**
+ * Run of framebuffer lines expanded by the stream producer.
+ */
+typedef struct {
+	const ili9341_fb8_t* fb;
+	const uint8_t* first;	/**< First index of the run. */
+} ili9341_fb8_run_t;
+
+/* Private methods. */
+
+bool _ili9341_fb8_line_dirty(const ili9341_fb8_t* fb, uint16_t line) {
+	return fb->full_flush || (fb->dirty[line / 8] & (1 << (line % 8)));
+}
+
+void _ili9341_fb8_expand(void* ctx, uint8_t* buf, uint32_t offset, uint32_t len) {
+	const ili9341_fb8_run_t* run = (const ili9341_fb8_run_t*)ctx;
+	const ili9341_fb8_t* fb = run->fb;
+	const uint8_t* in = run->first + offset / fb->pixel_size;
+
+	if (fb->pixel_size == 3) {
+		for (uint32_t i = 0; i < len; i += 3, in++) {
+			const uint8_t* pixel = &fb->lut[*in * 3];
+			buf[i] = pixel[0];
+			buf[i + 1] = pixel[1];
+			buf[i + 2] = pixel[2];
+		}
+	} else {
+		for (uint32_t i = 0; i < len; i += 2, in++) {
+			const uint8_t* pixel = &fb->lut[*in * 2];
+			buf[i] = pixel[0];
+			buf[i + 1] = pixel[1];
+		}
+	}
+}
+
+int _ili9341_fb8_flush(ili9341_fb8_t* fb) {
+	int err = ILI9341_SUCCESS;
+	uint16_t y = 0;
+
+	while (y < fb->height) {
+		if (!_ili9341_fb8_line_dirty(fb, y)) {
+			y++;
+			continue;
+		}
+
+		uint16_t first = y;
+		while (y < fb->height && _ili9341_fb8_line_dirty(fb, y)) {
+			y++;
+		}
+
+		coord_2d_t top_left = {.x = 0, .y = first};
+		coord_2d_t bottom_right = {.x = fb->width - 1, .y = y - 1};
+		ili9341_fb8_run_t run = {fb, &fb->pixels[(uint32_t)first * fb->width]};
+		err |= ili9341_set_region(fb->desc, top_left, bottom_right);
+		err |= ili9341_draw_stream(fb->desc, (uint32_t)(y - first) * fb->width * fb->pixel_size,
+				_ili9341_fb8_expand, &run);
+		if (err < 0) {
+			return err;
+		}
+	}
+
+	memset(fb->dirty, 0, sizeof(fb->dirty));
+	fb->full_flush = false;
+
+	return err;
+}
+
+/* Public interface methods. */
+
+int ili9341_fb8_init(ili9341_fb8_t* fb, ili9341_desc_ptr_t desc, uint8_t* pixels, uint32_t size) {
+	if (fb == NULL || desc == NULL || pixels == NULL) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+
+	fb->width = ili9341_get_screen_width(desc);
+	fb->height = ili9341_get_screen_height(desc);
+	if (size < (uint32_t)fb->width * fb->height || fb->height > ILI9341_GRAM_LINES) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+
+	fb->desc = desc;
+	fb->pixels = pixels;
+	fb->pixel_size = ili9341_get_pixel_size(desc);
+	memset(fb->dirty, 0, sizeof(fb->dirty));
+
+	uint16_t black = BLACK;
+	for (uint16_t i = 0; i < ILI9341_FB8_PALETTE_LEN; i++) {
+		ili9341_fb8_set_palette(fb, i, 1, &black);
+	}
+
+	return ILI9341_SUCCESS;
+}
+
+void ili9341_fb8_set_palette(ili9341_fb8_t* fb, uint8_t first, uint16_t count, const uint16_t* colors) {
+	for (uint16_t i = 0; i < count && first + i < ILI9341_FB8_PALETTE_LEN; i++) {
+		uint16_t idx = first + i;
+		fb->palette[idx] = colors[i];
+		ili9341_color_to_pixel(fb->desc, colors[i], &fb->lut[idx * fb->pixel_size]);
+	}
+	fb->full_flush = true;
+}
+
+void ili9341_fb8_mark_dirty(ili9341_fb8_t* fb, uint16_t first_line, uint16_t last_line) {
+	if (last_line >= fb->height) {
+		last_line = fb->height - 1;
+	}
+
+	for (uint16_t line = first_line; line <= last_line; line++) {
+		fb->dirty[line / 8] |= 1 << (line % 8);
+	}
+}
+
+void ili9341_fb8_fill_rect(ili9341_fb8_t* fb, coord_2d_t top_left, coord_2d_t bottom_right, uint8_t index) {
+	uint16_t x0 = (top_left.x < bottom_right.x) ? top_left.x : bottom_right.x;
+	uint16_t x1 = (top_left.x < bottom_right.x) ? bottom_right.x : top_left.x;
+	uint16_t y0 = (top_left.y < bottom_right.y) ? top_left.y : bottom_right.y;
+	uint16_t y1 = (top_left.y < bottom_right.y) ? bottom_right.y : top_left.y;
+
+	if (x0 >= fb->width || y0 >= fb->height) {
+		return;
+	}
+	if (x1 >= fb->width) {
+		x1 = fb->width - 1;
+	}
+	if (y1 >= fb->height) {
+		y1 = fb->height - 1;
+	}
+
+	for (uint16_t y = y0; y <= y1; y++) {
+		memset(&fb->pixels[(uint32_t)y * fb->width + x0], index, x1 - x0 + 1);
+	}
+	ili9341_fb8_mark_dirty(fb, y0, y1);
+}
+
+void ili9341_fb8_set_pixel(ili9341_fb8_t* fb, coord_2d_t pos, uint8_t index) {
+	if (pos.x >= fb->width || pos.y >= fb->height) {
+		return;
+	}
+
+	fb->pixels[(uint32_t)pos.y * fb->width + pos.x] = index;
+	fb->dirty[pos.y / 8] |= 1 << (pos.y % 8);
+}
+
+int ili9341_fb8_flush(ili9341_fb8_t* fb) {
+	ILI9341_PERF_API_BEGIN(fb->desc, ILI9341_API_FB8_FLUSH);
+	int err = _ili9341_fb8_flush(fb);
+	return ILI9341_PERF_API_END(fb->desc, ILI9341_API_FB8_FLUSH, err);
+}
@@ -0,0 +1,102 @@
+/*
+ * Indexed 8-bit framebuffer for ILI9341 driver
+ *
+ * Keeps the screen as 8-bit palette indices, half the RAM of an RGB565
+ * framebuffer, and expands it through the palette when flushed, see README.md.
+ *
+ * Author: Michal Horn
+ */
+
+#ifndef ILI9341_ILI9341_FB8_H_
+#define ILI9341_ILI9341_FB8_H_
+
+#include "ili9341.h"
+
+#define ILI9341_FB8_PALETTE_LEN       (256) /**< Number of palette entries. */
+
+/**
+ * Indexed framebuffer attached to a display driver instance.
+ *
+ * Allocated by the user, initialized by ili9341_fb8_init. The pixels may be
+ * drawn directly, the changed lines are then marked by ili9341_fb8_mark_dirty.
+ */
+typedef struct ili9341_fb8_st {
+	ili9341_desc_ptr_t desc;	/**< Display driver instance. */
+	uint8_t* pixels;	/**< Palette indices, width * height bytes, line by line. */
+	uint16_t width;	/**< Framebuffer width in pixels. */
+	uint16_t height;	/**< Framebuffer height in pixels. */
+	uint8_t pixel_size;	/**< Display pixel size in bytes. */
+	bool full_flush;	/**< All lines are flushed next time, after palette changes. */
+	uint8_t dirty[(ILI9341_GRAM_LINES + 7) / 8];	/**< Bitmap of lines changed since the last flush. */
+	uint16_t palette[ILI9341_FB8_PALETTE_LEN];	/**< RGB565 palette. */
+	uint8_t lut[ILI9341_FB8_PALETTE_LEN * 3];	/**< Palette converted to display pixels. */
+} ili9341_fb8_t;
+
+/**
+ * Initialize the indexed framebuffer.
+ *
+ * The framebuffer covers the whole screen in the current orientation. All
+ * palette entries are black and the first flush sends the whole screen.
+ *
+ * @param [out] fb Framebuffer to be initialized.
+ * @param [in] desc Display driver instance.
+ * @param [in] pixels Memory for the palette indices.
+ * @param [in] size Size of the memory, at least screen width * height bytes.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_fb8_init(ili9341_fb8_t* fb, ili9341_desc_ptr_t desc, uint8_t* pixels, uint32_t size);
+
+/**
+ * Change palette entries.
+ *
+ * The whole screen is expanded again with the next flush, so cycling palette
+ * colors animates the screen without touching the pixels.
+ *
+ * @param [in] fb Indexed framebuffer.
+ * @param [in] first First palette entry to change.
+ * @param [in] count Number of entries to change.
+ * @param [in] colors New RGB565 colors.
+ */
+void ili9341_fb8_set_palette(ili9341_fb8_t* fb, uint8_t first, uint16_t count, const uint16_t* colors);
+
+/**
+ * Mark framebuffer lines as changed.
+ *
+ * @param [in] fb Indexed framebuffer.
+ * @param [in] first_line First changed line.
+ * @param [in] last_line Last changed line.
+ */
+void ili9341_fb8_mark_dirty(ili9341_fb8_t* fb, uint16_t first_line, uint16_t last_line);
+
+/**
+ * Fill a rectangle of the framebuffer with a palette index.
+ *
+ * @param [in] fb Indexed framebuffer.
+ * @param [in] top_left Top left corner of the area.
+ * @param [in] bottom_right Bottom Right corner of the area.
+ * @param [in] index Palette index.
+ */
+void ili9341_fb8_fill_rect(ili9341_fb8_t* fb, coord_2d_t top_left, coord_2d_t bottom_right, uint8_t index);
+
+/**
+ * Set a single pixel of the framebuffer.
+ *
+ * @param [in] fb Indexed framebuffer.
+ * @param [in] pos Pixel position.
+ * @param [in] index Palette index.
+ */
+void ili9341_fb8_set_pixel(ili9341_fb8_t* fb, coord_2d_t pos, uint8_t index);
+
+/**
+ * Send the changed lines to the display.
+ *
+ * Consecutive changed lines are sent as one window, expanded through the
+ * palette into the staging buffers; a chunk is expanded while the previous one
+ * is being sent. In dma_async mode the pixels may change right after return.
+ *
+ * @param [in] fb Indexed framebuffer.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_fb8_flush(ili9341_fb8_t* fb);
+
+#endif /* ILI9341_ILI9341_FB8_H_ */
@@ -0,0 +1,304 @@
+/*
+ * Compressed images for ILI9341 driver
+ *
+ * Author: Michal Horn
+ */
+
+#include "ili9341_image.h"
+#include "ili9341_color.h"
+
+#define ILI9341_RLE_RUN 0x80	/**< RLE packet is a run of one color. */
+#define ILI9341_RLE_EXT 0x40	/**< RLE packet count continues in the next byte. */
+
+#define ILI9341_QOI_OP_INDEX 0x00
+#define ILI9341_QOI_OP_DIFF 0x40
+#define ILI9341_QOI_OP_LUMA 0x80
+#define ILI9341_QOI_OP_RUN 0xC0
+#define ILI9341_QOI_OP_RGB 0xFE
+#define ILI9341_QOI_OP_RUN16 0xFF
+#define ILI9341_QOI_OP_MASK 0xC0
+
+/**
+ * Streaming decoder state.
+ */
+typedef struct {
+	const ili9341_image_t* img;
+	ili9341_desc_ptr_t desc;
+	uint8_t pixel_size;
+	uint32_t pos;	/**< Position of the next packet or op in the data. */
+	uint32_t left;	/**< Pixels left in the current packet or run. */
+	bool literal;	/**< Current RLE packet holds literal pixels. */
+	uint16_t prev;	/**< Last decoded color. */
+	uint16_t index[ILI9341_IMAGE_QOI_INDEX_LEN];
+} ili9341_image_dec_t;
+
+/* Private methods. */
+
+uint16_t _ili9341_image_read16(const ili9341_image_dec_t* dec, uint32_t pos) {
+	return (dec->img->data[pos] << 8) | dec->img->data[pos + 1];
+}
+
+uint8_t _ili9341_image_qoi_hash(uint16_t color) {
+	return (((color >> 11) & 0x1F) * 3 + ((color >> 5) & 0x3F) * 5 + (color & 0x1F) * 7) % ILI9341_IMAGE_QOI_INDEX_LEN;
+}
+
+/*
+ * Parse the packet or op header at pos without decoding it. Gets the number of
+ * pixels, whether it is a run of one color and its total length in bytes.
+ */
+void _ili9341_image_parse(const ili9341_image_dec_t* dec, uint32_t pos, uint32_t* count, bool* run, uint32_t* bytes) {
+	const ili9341_image_t* img = dec->img;
+	uint8_t op = img->data[pos];
+	uint32_t left = img->size - pos;
+
+	if (img->format == ILI9341_IMAGE_RLE) {
+		uint32_t hdr = (op & ILI9341_RLE_EXT) ? 2 : 1;
+		if (left < hdr) {
+			*count = 0;
+			*run = false;
+			*bytes = UINT32_MAX;
+			return;
+		}
+		*count = ((op & ILI9341_RLE_EXT) ? (((op & 0x3F) << 8) | img->data[pos + 1]) : (op & 0x3F)) + 1;
+		*run = (op & ILI9341_RLE_RUN) != 0;
+		*bytes = hdr + (*run ? 2 : *count * 2);
+		return;
+	}
+
+	*count = 1;
+	*run = false;
+	if (op == ILI9341_QOI_OP_RGB) {
+		*bytes = 3;
+	} else if (op == ILI9341_QOI_OP_RUN16) {
+		*run = true;
+		*bytes = 3;
+		if (left >= 3) {
+			*count = _ili9341_image_read16(dec, pos + 1) + 1;
+		}
+	} else if ((op & ILI9341_QOI_OP_MASK) == ILI9341_QOI_OP_RUN) {
+		*run = true;
+		*count = (op & 0x3F) + 1;
+		*bytes = 1;
+	} else {
+		*bytes = ((op & ILI9341_QOI_OP_MASK) == ILI9341_QOI_OP_LUMA) ? 2 : 1;
+	}
+}
+
+/*
+ * Find how many pixels from the current position can be decoded before the
+ * next long run, and the length of that run. Validates the data on the way,
+ * so the decoder does not need to.
+ */
+int _ili9341_image_scan(const ili9341_image_dec_t* dec, uint32_t pixels, uint32_t* span, uint32_t* run_len) {
+	uint32_t pos = dec->pos;
+
+	*span = 0;
+	*run_len = 0;
+	while (*span < pixels) {
+		uint32_t count, bytes;
+		bool run;
+
+		if (pos >= dec->img->size) {
+			return -ILI9341_ERR_INV_PARAM;
+		}
+		_ili9341_image_parse(dec, pos, &count, &run, &bytes);
+		if (bytes > dec->img->size - pos || count > pixels - *span) {
+			return -ILI9341_ERR_INV_PARAM;
+		}
+
+		if (run && count >= ILI9341_IMAGE_RUN_FILL_MIN) {
+			*run_len = count;
+			break;
+		}
+		*span += count;
+		pos += bytes;
+	}
+
+	return ILI9341_SUCCESS;
+}
+
+uint16_t _ili9341_image_next_rle(ili9341_image_dec_t* dec) {
+	if (dec->left == 0) {
+		uint32_t bytes;
+		bool run;
+		_ili9341_image_parse(dec, dec->pos, &dec->left, &run, &bytes);
+		dec->literal = !run;
+		dec->pos += (dec->img->data[dec->pos] & ILI9341_RLE_EXT) ? 2 : 1;
+		if (run) {
+			dec->prev = _ili9341_image_read16(dec, dec->pos);
+			dec->pos += 2;
+		}
+	}
+
+	if (dec->literal) {
+		dec->prev = _ili9341_image_read16(dec, dec->pos);
+		dec->pos += 2;
+	}
+	dec->left--;
+
+	return dec->prev;
+}
+
+uint16_t _ili9341_image_next_qoi(ili9341_image_dec_t* dec) {
+	if (dec->left > 0) {
+		dec->left--;
+		return dec->prev;
+	}
+
+	const uint8_t* data = dec->img->data;
+	uint8_t op = data[dec->pos++];
+	uint16_t r = (dec->prev >> 11) & 0x1F;
+	uint16_t g = (dec->prev >> 5) & 0x3F;
+	uint16_t b = dec->prev & 0x1F;
+
+	if (op == ILI9341_QOI_OP_RGB) {
+		dec->prev = _ili9341_image_read16(dec, dec->pos);
+		dec->pos += 2;
+	} else if (op == ILI9341_QOI_OP_RUN16) {
+		dec->left = _ili9341_image_read16(dec, dec->pos);
+		dec->pos += 2;
+		return dec->prev;
+	} else {
+		switch (op & ILI9341_QOI_OP_MASK) {
+		case ILI9341_QOI_OP_INDEX:
+			dec->prev = dec->index[op];
+			break;
+		case ILI9341_QOI_OP_DIFF:
+			r = (r + ((op >> 4) & 0x03) - 2) & 0x1F;
+			g = (g + ((op >> 2) & 0x03) - 2) & 0x3F;
+			b = (b + (op & 0x03) - 2) & 0x1F;
+			dec->prev = (r << 11) | (g << 5) | b;
+			break;
+		case ILI9341_QOI_OP_LUMA: {
+			uint8_t rb = data[dec->pos++];
+			r = (r + (rb >> 4) - 8) & 0x1F;
+			g = (g + (op & 0x3F) - 32) & 0x3F;
+			b = (b + (rb & 0x0F) - 8) & 0x1F;
+			dec->prev = (r << 11) | (g << 5) | b;
+			break;
+		}
+		default:
+			dec->left = op & 0x3F;
+			return dec->prev;
+		}
+	}
+
+	dec->index[_ili9341_image_qoi_hash(dec->prev)] = dec->prev;
+	return dec->prev;
+}
+
+void _ili9341_image_decode(void* ctx, uint8_t* buf, uint32_t offset, uint32_t len) {
+	ili9341_image_dec_t* dec = (ili9341_image_dec_t*)ctx;
+	(void)offset;
+
+	for (uint32_t i = 0; i < len; i += dec->pixel_size) {
+		uint16_t color = (dec->img->format == ILI9341_IMAGE_RLE) ?
+				_ili9341_image_next_rle(dec) : _ili9341_image_next_qoi(dec);
+		if (dec->pixel_size == 2) {
+			buf[i] = color >> 8;
+			buf[i + 1] = color & 0xFF;
+		} else {
+			ili9341_color_to_pixel(dec->desc, color, &buf[i]);
+		}
+	}
+}
+
+/*
+ * Take the long run found by the scan and send it as a solid fill.
+ */
+int _ili9341_image_fill_run(ili9341_image_dec_t* dec) {
+	uint32_t count, bytes;
+	bool run;
+
+	_ili9341_image_parse(dec, dec->pos, &count, &run, &bytes);
+	if (dec->img->format == ILI9341_IMAGE_RLE) {
+		dec->prev = _ili9341_image_read16(dec, dec->pos + bytes - 2);
+	}
+	dec->pos += bytes;
+
+	return ili9341_fill_pixels(dec->desc, dec->prev, count);
+}
+
+int _ili9341_image_draw_compressed(const ili9341_desc_ptr_t desc, const ili9341_image_t* img) {
+	int err = ILI9341_SUCCESS;
+	ili9341_image_dec_t dec;
+
+	dec.img = img;
+	dec.desc = desc;
+	dec.pixel_size = ili9341_get_pixel_size(desc);
+	dec.pos = 0;
+	dec.left = 0;
+	dec.literal = false;
+	dec.prev = BLACK;
+	for (uint8_t i = 0; i < ILI9341_IMAGE_QOI_INDEX_LEN; i++) {
+		dec.index[i] = BLACK;
+	}
+
+	uint32_t pixels = (uint32_t)img->width * img->height;
+	while (pixels > 0) {
+		uint32_t span, run_len;
+		err |= _ili9341_image_scan(&dec, pixels, &span, &run_len);
+		if (err < 0) {
+			return err;
+		}
+
+		if (span > 0) {
+			err |= ili9341_draw_stream(desc, span * dec.pixel_size, _ili9341_image_decode, &dec);
+		}
+		if (run_len > 0) {
+			err |= _ili9341_image_fill_run(&dec);
+		}
+		if (err < 0) {
+			return err;
+		}
+		pixels -= span + run_len;
+	}
+
+	return err;
+}
+
+int _ili9341_image_draw(const ili9341_desc_ptr_t desc, coord_2d_t top_left, const ili9341_image_t* img) {
+	int err = ILI9341_SUCCESS;
+
+	if (img == NULL || img->data == NULL || img->width == 0 || img->height == 0) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+
+	switch (img->format) {
+	case ILI9341_IMAGE_RGB565:
+		if (img->size < (uint32_t)img->width * img->height * 2) {
+			return -ILI9341_ERR_INV_PARAM;
+		}
+		return ili9341_blit_RGB565(desc, top_left, img->data, (uint32_t)img->width * 2, img->width, img->height);
+	case ILI9341_IMAGE_INDEXED: {
+		uint32_t stride = ((uint32_t)img->width * img->bpp + 7) / 8;
+		if (img->size < stride * img->height) {
+			return -ILI9341_ERR_INV_PARAM;
+		}
+		return ili9341_blit_indexed(desc, top_left, img->data, stride, img->width, img->height, img->bpp, img->palette);
+	}
+	case ILI9341_IMAGE_RLE:
+	case ILI9341_IMAGE_QOI:
+		break;
+	default:
+		return -ILI9341_ERR_INV_PARAM;
+	}
+
+	coord_2d_t bottom_right = {top_left.x + img->width - 1, top_left.y + img->height - 1};
+	err |= ili9341_set_region(desc, top_left, bottom_right);
+	if (err < 0) {
+		return err;
+	}
+
+	err |= _ili9341_image_draw_compressed(desc, img);
+
+	return err;
+}
+
+/* Public interface methods. */
+
+int ili9341_draw_image(const ili9341_desc_ptr_t desc, coord_2d_t top_left, const ili9341_image_t* img) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_DRAW_IMAGE);
+	int err = _ili9341_image_draw(desc, top_left, img);
+	return ILI9341_PERF_API_END(desc, ILI9341_API_DRAW_IMAGE, err);
+}
@@ -0,0 +1,82 @@
+/*
+ * Compressed images for ILI9341 driver
+ *
+ * Images stored raw, palette indexed or compressed, decoded on the fly into
+ * the staging buffers, see README.md.
+ *
+ * Author: Michal Horn
+ */
+
+#ifndef ILI9341_ILI9341_IMAGE_H_
+#define ILI9341_ILI9341_IMAGE_H_
+
+#include "ili9341.h"
+
+#define ILI9341_IMAGE_RUN_FILL_MIN    (32) /**< Runs of at least this many pixels are sent as solid fills instead of decoded data. */
+#define ILI9341_IMAGE_QOI_INDEX_LEN   (64) /**< Number of recently seen colors of the QOI-style codec. */
+
+/**
+ * Image data format.
+ */
+typedef enum {
+	/**
+	 * Big endian RGB565 pixels, as for ili9341_draw_RGB565_dma.
+	 */
+	ILI9341_IMAGE_RGB565,
+	/**
+	 * Palette indexed pixels, lines start at byte boundary, as for
+	 * ili9341_blit_indexed.
+	 */
+	ILI9341_IMAGE_INDEXED,
+	/**
+	 * Run length encoded RGB565 pixels. Packets start with a header byte: bit 7
+	 * set for a run of one color, clear for literal pixels, bit 6 set when the
+	 * count continues in the next byte. The count - 1 is in bits 5-0, or bits
+	 * 5-0 and the next byte. A run is followed by one big endian RGB565 color,
+	 * literal packet by count colors.
+	 */
+	ILI9341_IMAGE_RLE,
+	/**
+	 * QOI-style encoded RGB565 pixels. The previous pixel starts black and the
+	 * index of recent colors all black. Ops:
+	 * 00iiiiii - color index[i],
+	 * 01rrggbb - previous color with r, g, b channels changed by -2..1,
+	 * 10gggggg rrrrbbbb - previous color with g changed by -32..31, r and b by -8..7,
+	 * 11nnnnnn - run of n + 1 previous colors, n < 62,
+	 * 0xFE followed by big endian RGB565 color,
+	 * 0xFF followed by big endian 16-bit n - run of n + 1 previous colors.
+	 * Channel changes wrap around. Every color produced by other than run ops
+	 * is stored in the index at (r * 3 + g * 5 + b * 7) % 64.
+	 */
+	ILI9341_IMAGE_QOI,
+} ili9341_image_format_t;
+
+/**
+ * Image stored in memory, typically a constant generated from an image file.
+ */
+typedef struct ili9341_image_st {
+	uint16_t width;	/**< Width in pixels. */
+	uint16_t height;	/**< Height in pixels. */
+	ili9341_image_format_t format;	/**< Format of the data. */
+	uint8_t bpp;	/**< Bits per pixel of ILI9341_IMAGE_INDEXED images. */
+	const uint16_t* palette;	/**< RGB565 palette of ILI9341_IMAGE_INDEXED images. */
+	const uint8_t* data;	/**< Image data. */
+	uint32_t size;	/**< Size of the data in bytes. */
+} ili9341_image_t;
+
+/**
+ * Draw an image.
+ *
+ * Compressed images are decoded chunk by chunk into the staging buffers while
+ * the previous chunk is being sent, the whole decoded image never exists in
+ * memory. Long runs of one color are sent as solid fills, by constant source
+ * DMA when spi_tx_repeat is available.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] top_left Top left corner of the display area.
+ * @param [in] img Image to draw.
+ * @returns ILI9341_SUCCESS or negative error code, -ILI9341_ERR_INV_PARAM for corrupted data.
+ */
+int ili9341_draw_image(const ili9341_desc_ptr_t desc, coord_2d_t top_left, const ili9341_image_t* img);
+
+#endif /* ILI9341_ILI9341_IMAGE_H_ */
@@ -0,0 +1,263 @@
+/*
+ * Command stream recorder for ILI9341 driver
+ *
+ * Author: Michal Horn
+ */
+
+#include "ili9341_rec.h"
+#include "ili9341_spi_cmds.h"
+#include "string.h"
+
+static const uint8_t ili9341_rec_magic[4] = {'I', 'L', 'I', 'R'};
+
+/* Private methods. */
+
+uint8_t _ili9341_rec_varint_len(uint32_t val) {
+	uint8_t len = 1;
+	while (val >= 0x80) {
+		val >>= 7;
+		len++;
+	}
+	return len;
+}
+
+void _ili9341_rec_put_varint(ili9341_rec_t* rec, uint32_t val) {
+	while (val >= 0x80) {
+		rec->buf[rec->len++] = (uint8_t)(val | 0x80);
+		val >>= 7;
+	}
+	rec->buf[rec->len++] = (uint8_t)val;
+}
+
+bool _ili9341_rec_get_varint(const uint8_t* log, uint32_t len, uint32_t* pos, uint32_t* val) {
+	*val = 0;
+	for (uint8_t shift = 0; shift < 35; shift += 7) {
+		if (*pos >= len) {
+			return false;
+		}
+		uint8_t byte = log[(*pos)++];
+		*val |= (uint32_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Append one transaction to the log. Once a record does not fit, recording
+ * stops, so the log never misses a transaction in the middle.
+ */
+void _ili9341_rec_observe(void* ctx, const ili9341_txn_t* txn) {
+	ili9341_rec_t* rec = (ili9341_rec_t*)ctx;
+	uint32_t now = ili9341_get_uptime_ms(rec->desc);
+	uint32_t delay = now - rec->last_ms;
+	uint8_t flags = 0;
+	uint32_t need = 1;
+
+	if (rec->overflow) {
+		return;
+	}
+
+	if (delay > 0) {
+		flags |= ILI9341_REC_DELAY;
+		need += _ili9341_rec_varint_len(delay);
+	}
+	if (txn->flags & ILI9341_TXN_FLAG_NO_CMD) {
+		flags |= ILI9341_REC_NO_CMD;
+	} else {
+		need += 2 + txn->params_len;
+	}
+	need += _ili9341_rec_varint_len(txn->payload_len);
+	if (txn->flags & ILI9341_TXN_FLAG_REPEAT) {
+		flags |= ILI9341_REC_REPEAT;
+		need += ILI9341_REPEAT_PATTERN_LEN;
+	} else if (rec->payloads && txn->payload_len > 0) {
+		flags |= ILI9341_REC_PAYLOAD;
+		need += txn->payload_len;
+	}
+
+	if (need > rec->size - rec->len) {
+		rec->overflow = true;
+		return;
+	}
+
+	rec->buf[rec->len++] = flags;
+	if (flags & ILI9341_REC_DELAY) {
+		_ili9341_rec_put_varint(rec, delay);
+	}
+	if (!(flags & ILI9341_REC_NO_CMD)) {
+		rec->buf[rec->len++] = txn->cmd;
+		rec->buf[rec->len++] = txn->params_len;
+		memcpy(&rec->buf[rec->len], txn->params, txn->params_len);
+		rec->len += txn->params_len;
+	}
+	_ili9341_rec_put_varint(rec, txn->payload_len);
+	if (flags & ILI9341_REC_REPEAT) {
+		memcpy(&rec->buf[rec->len], txn->payload, ILI9341_REPEAT_PATTERN_LEN);
+		rec->len += ILI9341_REPEAT_PATTERN_LEN;
+	} else if (flags & ILI9341_REC_PAYLOAD) {
+		if (txn->flags & ILI9341_TXN_FLAG_SEGMENTS) {
+			for (uint16_t i = 0; i < txn->seg_cnt; i++) {
+				memcpy(&rec->buf[rec->len], txn->segs[i].data, txn->segs[i].len);
+				rec->len += txn->segs[i].len;
+			}
+		} else {
+			memcpy(&rec->buf[rec->len], txn->payload, txn->payload_len);
+			rec->len += txn->payload_len;
+		}
+	}
+
+	rec->last_ms = now;
+	rec->records++;
+}
+
+/*
+ * Send a payload missing in the log, black pixels followed by zeros for a
+ * partial pixel.
+ */
+int _ili9341_rec_replay_blank(ili9341_desc_ptr_t desc, uint32_t len) {
+	static const uint8_t zeros[3] = {0, 0, 0};
+	uint8_t pixel_size = ili9341_get_pixel_size(desc);
+	int err = ILI9341_SUCCESS;
+
+	if (len >= pixel_size) {
+		err |= ili9341_fill_pixels(desc, 0x0000, len / pixel_size);
+	}
+	if (len % pixel_size > 0) {
+		ili9341_txn_t txn;
+		txn.cmd = ILI9341_CMD_NOP;
+		txn.flags = ILI9341_TXN_FLAG_NO_CMD;
+		txn.params_len = 0;
+		txn.payload = zeros;
+		txn.payload_len = len % pixel_size;
+		err |= ili9341_send_txn(desc, &txn);
+	}
+
+	return err;
+}
+
+int _ili9341_rec_replay(ili9341_desc_ptr_t desc, const uint8_t* log, uint32_t len, ili9341_rec_delay_t delay) {
+	int err = ILI9341_SUCCESS;
+	uint32_t pos = ILI9341_REC_HEADER_LEN;
+
+	if (log == NULL || len < ILI9341_REC_HEADER_LEN ||
+			memcmp(log, ili9341_rec_magic, sizeof(ili9341_rec_magic)) != 0 ||
+			log[4] != ILI9341_REC_VERSION ||
+			log[6] != ili9341_get_pixel_size(desc)) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+
+	while (pos < len && err == ILI9341_SUCCESS) {
+		uint8_t flags = log[pos++];
+		uint32_t ms = 0;
+		ili9341_txn_t txn;
+
+		if ((flags & ILI9341_REC_DELAY) && !_ili9341_rec_get_varint(log, len, &pos, &ms)) {
+			return -ILI9341_ERR_INV_PARAM;
+		}
+
+		txn.cmd = ILI9341_CMD_NOP;
+		txn.flags = 0;
+		txn.params_len = 0;
+		txn.payload = NULL;
+		txn.payload_len = 0;
+		if (flags & ILI9341_REC_NO_CMD) {
+			txn.flags = ILI9341_TXN_FLAG_NO_CMD;
+		} else {
+			if (len - pos < 2) {
+				return -ILI9341_ERR_INV_PARAM;
+			}
+			txn.cmd = log[pos++];
+			txn.params_len = log[pos++];
+			if (txn.params_len > ILI9341_TXN_MAX_PARAMS || len - pos < txn.params_len) {
+				return -ILI9341_ERR_INV_PARAM;
+			}
+			memcpy(txn.params, &log[pos], txn.params_len);
+			pos += txn.params_len;
+		}
+
+		uint32_t payload_len;
+		if (!_ili9341_rec_get_varint(log, len, &pos, &payload_len)) {
+			return -ILI9341_ERR_INV_PARAM;
+		}
+		const uint8_t* payload = &log[pos];
+		uint32_t stored = 0;
+		if (flags & ILI9341_REC_REPEAT) {
+			stored = ILI9341_REPEAT_PATTERN_LEN;
+		} else if (flags & ILI9341_REC_PAYLOAD) {
+			stored = payload_len;
+		}
+		if (len - pos < stored) {
+			return -ILI9341_ERR_INV_PARAM;
+		}
+		pos += stored;
+
+		if (delay != NULL && ms > 0) {
+			err |= ili9341_wait_idle(desc);
+			delay(ms);
+		}
+
+		if (flags & ILI9341_REC_PAYLOAD) {
+			txn.payload = payload;
+			txn.payload_len = payload_len;
+			payload_len = 0;
+		}
+		if (!(flags & ILI9341_REC_NO_CMD) || txn.payload_len > 0) {
+			err |= ili9341_send_txn(desc, &txn);
+		}
+		if (payload_len == 0) {
+			continue;
+		}
+
+		/* The repeated pattern is the pixel color, see ili9341_fill_pixels. */
+		if (flags & ILI9341_REC_REPEAT) {
+			uint16_t color = ((uint16_t)payload[0] << 8) | payload[1];
+			err |= ili9341_fill_pixels(desc, color, payload_len / ILI9341_REPEAT_PATTERN_LEN);
+		} else {
+			err |= _ili9341_rec_replay_blank(desc, payload_len);
+		}
+	}
+
+	err |= ili9341_wait_idle(desc);
+
+	return err;
+}
+
+/* Public interface methods. */
+
+int ili9341_rec_start(ili9341_rec_t* rec, ili9341_desc_ptr_t desc, uint8_t* buf, uint32_t size, bool payloads) {
+	if (rec == NULL || desc == NULL || buf == NULL || size < ILI9341_REC_HEADER_LEN) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+
+	rec->desc = desc;
+	rec->buf = buf;
+	rec->size = size;
+	rec->records = 0;
+	rec->last_ms = ili9341_get_uptime_ms(desc);
+	rec->payloads = payloads;
+	rec->overflow = false;
+
+	memcpy(buf, ili9341_rec_magic, sizeof(ili9341_rec_magic));
+	buf[4] = ILI9341_REC_VERSION;
+	buf[5] = payloads ? ILI9341_REC_LOG_PAYLOADS : 0;
+	buf[6] = ili9341_get_pixel_size(desc);
+	rec->len = ILI9341_REC_HEADER_LEN;
+
+	ili9341_set_txn_observer(desc, _ili9341_rec_observe, rec);
+
+	return ILI9341_SUCCESS;
+}
+
+int ili9341_rec_stop(ili9341_rec_t* rec) {
+	ili9341_set_txn_observer(rec->desc, NULL, NULL);
+
+	return rec->overflow ? -ILI9341_ERR_INV_PARAM : ILI9341_SUCCESS;
+}
+
+int ili9341_rec_replay(ili9341_desc_ptr_t desc, const uint8_t* log, uint32_t len, ili9341_rec_delay_t delay) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_REC_REPLAY);
+	int err = _ili9341_rec_replay(desc, log, len, delay);
+	return ILI9341_PERF_API_END(desc, ILI9341_API_REC_REPLAY, err);
+}
@@ -0,0 +1,100 @@
+/*
+ * Command stream recorder for ILI9341 driver
+ *
+ * Records the commands, parameters and payloads a display driver instance
+ * sends into a compact binary log and replays the log to another instance,
+ * see README.md.
+ *
+ * Author: Michal Horn
+ */
+
+#ifndef ILI9341_ILI9341_REC_H_
+#define ILI9341_ILI9341_REC_H_
+
+#include "ili9341.h"
+
+#define ILI9341_REC_VERSION (1)	/**< Log format version. */
+#define ILI9341_REC_HEADER_LEN (7)	/**< Log header - 4 bytes magic "ILIR", version, flags and pixel size. */
+#define ILI9341_REC_LOG_PAYLOADS 0x01	/**< Header flag, the log holds the payload data, not only its size. */
+
+#define ILI9341_REC_NO_CMD 0x01	/**< Record flag, data continuing the previous command. */
+#define ILI9341_REC_REPEAT 0x02	/**< Record flag, repeated pattern of ILI9341_REPEAT_PATTERN_LEN bytes. */
+#define ILI9341_REC_PAYLOAD 0x04	/**< Record flag, payload data follow. */
+#define ILI9341_REC_DELAY 0x08	/**< Record flag, time since the previous record follows. */
+
+/**
+ * Delay used to replay the log with the original pacing.
+ *
+ * @param [in] ms Time in milliseconds.
+ */
+typedef void (*ili9341_rec_delay_t)(uint32_t ms);
+
+/**
+ * Command stream recorder attached to a display driver instance.
+ *
+ * Allocated by the user, initialized by ili9341_rec_start.
+ */
+typedef struct ili9341_rec_st {
+	ili9341_desc_ptr_t desc;	/**< Recorded display driver instance. */
+	uint8_t* buf;	/**< Log buffer. */
+	uint32_t size;	/**< Log buffer size in bytes. */
+	uint32_t len;	/**< Log length in bytes. */
+	uint32_t records;	/**< Number of recorded transactions. */
+	uint32_t last_ms;	/**< Uptime of the previous record. */
+	bool payloads;	/**< Record the payload data. */
+	bool overflow;	/**< The log buffer got full, the following transactions were dropped. */
+} ili9341_rec_t;
+
+/**
+ * Start recording the transactions of a display driver instance.
+ *
+ * Every transaction queued to the bus is appended to the log as one record:
+ *
+ * - flags byte, ILI9341_REC_* flags,
+ * - milliseconds since the previous record as LEB128 when ILI9341_REC_DELAY is set,
+ * - command code, parameters count and parameters unless ILI9341_REC_NO_CMD is set,
+ * - payload length as LEB128,
+ * - repeated pattern when ILI9341_REC_REPEAT is set,
+ * - payload data when ILI9341_REC_PAYLOAD is set.
+ *
+ * Without payloads, the log keeps the exact command stream and the sizes of
+ * the pixel data only, a few bytes per transaction.
+ *
+ * @param [out] rec Recorder to be initialized.
+ * @param [in] desc Display driver instance.
+ * @param [in] buf Log buffer, holds at least ILI9341_REC_HEADER_LEN bytes.
+ * @param [in] size Log buffer size in bytes.
+ * @param [in] payloads Record the payload data.
+ * @returns ILI9341_SUCCESS or -ILI9341_ERR_INV_PARAM when the buffer is too small.
+ */
+int ili9341_rec_start(ili9341_rec_t* rec, ili9341_desc_ptr_t desc, uint8_t* buf, uint32_t size, bool payloads);
+
+/**
+ * Stop recording.
+ *
+ * The log is rec->len bytes long. When the buffer got full, the log ends with
+ * the last transaction that fitted.
+ *
+ * @param [in] rec Recorder.
+ * @returns ILI9341_SUCCESS or -ILI9341_ERR_INV_PARAM when transactions were dropped.
+ */
+int ili9341_rec_stop(ili9341_rec_t* rec);
+
+/**
+ * Replay a log to a display driver instance.
+ *
+ * The instance must be initialized in the pixel format of the recorded one,
+ * its HAL may be a different one, e.g. the controller emulator on a host.
+ * Payloads missing in the log are replayed as black pixels of the recorded
+ * size. Without delay, the transactions are sent back to back, the maximal
+ * pacing, with delay, the recorded time between them is waited out first.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] log Log data.
+ * @param [in] len Log length in bytes.
+ * @param [in] delay Delay for the original pacing, NULL for the maximal pacing.
+ * @returns ILI9341_SUCCESS, -ILI9341_ERR_INV_PARAM for a malformed log, or negative error code.
+ */
+int ili9341_rec_replay(ili9341_desc_ptr_t desc, const uint8_t* log, uint32_t len, ili9341_rec_delay_t delay);
+
+#endif /* ILI9341_ILI9341_REC_H_ */
@@ -0,0 +1,72 @@
+/*
+ * Line strip renderer for ILI9341 driver
+ *
+ * Author: Michal Horn
+ */
+
+#include "ili9341_strip.h"
+
+#define ILI9341_STRIP_BYTES_PER_PIXEL 2
+
+/* Private methods. */
+
+int _ili9341_strip_render(const ili9341_desc_ptr_t desc, uint8_t* arena, uint32_t arena_size,
+		ili9341_strip_render_t render, void* ctx) {
+	int err = ILI9341_SUCCESS;
+	uint16_t width = ili9341_get_screen_width(desc);
+	uint16_t height = ili9341_get_screen_height(desc);
+	uint32_t line_size = (uint32_t)width * ILI9341_STRIP_BYTES_PER_PIXEL;
+
+	if (arena == NULL || render == NULL || line_size == 0) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+
+	uint32_t fit_lines = arena_size / (ILI9341_STRIP_BUF_CNT * line_size);
+	if (fit_lines == 0) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+	uint16_t strip_lines = (fit_lines > height) ? height : (uint16_t)fit_lines;
+
+	uint32_t fences[ILI9341_STRIP_BUF_CNT];
+	bool in_flight[ILI9341_STRIP_BUF_CNT] = {false};
+	uint8_t buf_idx = 0;
+
+	for (uint16_t y = 0; y < height; y += strip_lines) {
+		uint16_t rest = height - y;
+		uint16_t lines = (rest < strip_lines) ? rest : strip_lines;
+		uint8_t* buf = arena + buf_idx * strip_lines * line_size;
+
+		/* The buffer is free once the strip sent from it two rounds ago is out. */
+		if (in_flight[buf_idx]) {
+			err |= ili9341_wait_fence(desc, fences[buf_idx]);
+			if (err < 0) {
+				return err;
+			}
+		}
+
+		render(ctx, buf, width, y, lines);
+
+		coord_2d_t top_left = {.x = 0, .y = y};
+		coord_2d_t bottom_right = {.x = width - 1, .y = y + lines - 1};
+		err |= ili9341_set_region(desc, top_left, bottom_right);
+		err |= ili9341_draw_RGB565_dma(desc, buf, lines * line_size);
+		if (err < 0) {
+			return err;
+		}
+
+		fences[buf_idx] = ili9341_fence(desc);
+		in_flight[buf_idx] = true;
+		buf_idx = (buf_idx + 1) % ILI9341_STRIP_BUF_CNT;
+	}
+
+	return err;
+}
+
+/* Public interface methods. */
+
+int ili9341_strip_render(const ili9341_desc_ptr_t desc, uint8_t* arena, uint32_t arena_size,
+		ili9341_strip_render_t render, void* ctx) {
+	ILI9341_PERF_API_BEGIN(desc, ILI9341_API_STRIP_RENDER);
+	int err = _ili9341_strip_render(desc, arena, arena_size, render, ctx);
+	return ILI9341_PERF_API_END(desc, ILI9341_API_STRIP_RENDER, err);
+}
@@ -0,0 +1,49 @@
+/*
+ * Line strip renderer for ILI9341 driver
+ *
+ * Renders the screen in strips of several lines into a small user provided
+ * arena, so no full framebuffer is needed, see README.md.
+ *
+ * Author: Michal Horn
+ */
+
+#ifndef ILI9341_ILI9341_STRIP_H_
+#define ILI9341_ILI9341_STRIP_H_
+
+#include "ili9341.h"
+
+#define ILI9341_STRIP_BUF_CNT         (2)  /**< Number of strip buffers the arena is split to. */
+
+/**
+ * User defined strip rendering function.
+ *
+ * Draws the screen lines first_line to first_line + lines - 1 into the strip
+ * buffer as RGB565 data in the format of ili9341_draw_RGB565_dma.
+ *
+ * @param [in] ctx User context passed to ili9341_strip_render.
+ * @param [out] buf Strip buffer, width * lines pixels.
+ * @param [in] width Strip width in pixels.
+ * @param [in] first_line Screen line of the first strip line.
+ * @param [in] lines Number of lines in the strip.
+ */
+typedef void (*ili9341_strip_render_t)(void* ctx, uint8_t* buf, uint16_t width, uint16_t first_line, uint16_t lines);
+
+/**
+ * Render the whole screen strip by strip.
+ *
+ * The arena is split into ILI9341_STRIP_BUF_CNT strip buffers of as many
+ * full lines as fit. While one strip is being sent, the next one is rendered
+ * into the other buffer. In dma_async mode the function returns when the last
+ * strip is queued and the arena must stay valid until ili9341_wait_idle returns.
+ *
+ * @param [in] desc Display driver instance.
+ * @param [in] arena Memory for the strip buffers.
+ * @param [in] arena_size Size of the arena in bytes.
+ * @param [in] render User defined strip rendering function.
+ * @param [in] ctx User context passed to the render function.
+ * @returns ILI9341_SUCCESS or negative error code.
+ */
+int ili9341_strip_render(const ili9341_desc_ptr_t desc, uint8_t* arena, uint32_t arena_size,
+		ili9341_strip_render_t render, void* ctx);
+
+#endif /* ILI9341_ILI9341_STRIP_H_ */
@@ -0,0 +1,542 @@
+/*
+ * Host tests of ILI9341 driver
+ *
+ * Drives the public API against the controller emulator and checks the frame
+ * memory, see README.md.
+ *
+ * Author: Michal Horn
+ */
+
+#include <stdio.h>
+#include "string.h"
+#include "ili9341.h"
+#include "ili9341_color.h"
+#include "ili9341_image.h"
+#include "ili9341_rec.h"
+#include "ili9341_emu.h"
+
+#define ILI9341_TEST_WIDTH (240)	/**< Screen width in the vertical orientation. */
+#define ILI9341_TEST_HEIGHT (320)	/**< Screen height in the vertical orientation. */
+#define ILI9341_TEST_SCROLL_TFA (16)	/**< Top fixed area of the scrolling test. */
+#define ILI9341_TEST_SCROLL_BFA (16)	/**< Bottom fixed area of the scrolling test. */
+
+#define ILI9341_TEST_CHECK(cond) _ili9341_test_check((cond), #cond, __func__, __LINE__)
+
+/**
+ * Test body, returns the number of failed checks.
+ */
+typedef int (*ili9341_test_fn_t)(void);
+
+typedef struct {
+	const char* name;
+	ili9341_test_fn_t fn;
+} ili9341_test_t;
+
+/* Display in the 16-bit pixel format, synchronous, with constant source and scatter-gather DMA. */
+static ili9341_emu_ptr_t ili9341_test_emu;
+static ili9341_desc_ptr_t ili9341_test_desc;
+/* Display in the 18-bit pixel format, dma_async, the DMA interrupt played from the wait loop. */
+static ili9341_emu_ptr_t ili9341_test_emu666;
+static ili9341_desc_ptr_t ili9341_test_desc666;
+
+static spi_tx_dma_ready_t ili9341_test_emu666_ready;
+static uint32_t ili9341_test_notified;
+/* TE pulse period of the 18-bit display played by its wait loop, 0 for no pulses. */
+static uint32_t ili9341_test_te_period;
+static uint32_t ili9341_test_te_phase;
+static uint8_t ili9341_test_image[ILI9341_TEST_WIDTH * 100 * 2];
+static uint8_t ili9341_test_log[ILI9341_TEST_WIDTH * ILI9341_TEST_HEIGHT * 2 + 4096];
+
+/*
+ * RLE image of 20x10 pixels - run of 100 red, 4 literal pixels, run of 96 blue.
+ */
+static const uint8_t ili9341_test_rle[] = {
+	0xC0, 99, 0xF8, 0x00,
+	0x03, 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF0,
+	0xC0, 95, 0x00, 0x1F,
+};
+
+/*
+ * QOI-style image of 20x10 pixels - green, run of 99 green, green from the
+ * index, blue, runs of 62 and 36 blue.
+ */
+static const uint8_t ili9341_test_qoi[] = {
+	0xFE, 0x07, 0xE0,
+	0xFF, 0x00, 0x62,
+	0x3B,
+	0xFE, 0x00, 0x1F,
+	0xC0 | 61,
+	0xC0 | 35,
+};
+
+/* Private methods. */
+
+int _ili9341_test_check(bool ok, const char* cond, const char* func, int line) {
+	if (!ok) {
+		printf("FAIL %s:%d %s\n", func, line, cond);
+	}
+	return ok ? 0 : 1;
+}
+
+uint16_t _ili9341_test_color(uint32_t i) {
+	return (uint16_t)(i * 2654435761u >> 16);
+}
+
+/*
+ * Wait loop hook of the 18-bit display, plays the DMA complete interrupt and,
+ * while ili9341_test_te_period is set, lets a millisecond pass and raises the
+ * TE edges, the first one a millisecond after the phase is cleared.
+ */
+void _ili9341_test_irq(void) {
+	ili9341_emu_irq(ili9341_test_emu666);
+	if (ili9341_test_te_period > 0) {
+		ili9341_emu_advance_ms(ili9341_test_emu666, 1);
+		if (++ili9341_test_te_phase % ili9341_test_te_period == 1) {
+			ili9341_te_cb(ili9341_test_desc666);
+		}
+	}
+}
+
+/*
+ * Ready flag of the 18-bit display. The DMA complete interrupt comes together
+ * with the flag, once per transfer, also while the init sequence polls it.
+ */
+bool _ili9341_test_ready_isr(void) {
+	bool ready = ili9341_test_emu666_ready();
+	uint32_t transfers = ili9341_emu_get_stats(ili9341_test_emu666).transfers;
+
+	if (ready && transfers != ili9341_test_notified && ili9341_test_desc666 != NULL) {
+		ili9341_test_notified = transfers;
+		ili9341_spi_tx_done_cb(ili9341_test_desc666);
+	}
+	return ready;
+}
+
+/*
+ * Count the pixels of the screen rectangle that differ from the color.
+ */
+uint32_t _ili9341_test_count_bad(ili9341_emu_ptr_t emu, coord_2d_t top_left, coord_2d_t bottom_right, uint16_t color) {
+	uint32_t bad = 0;
+
+	for (uint16_t y = top_left.y; y <= bottom_right.y; y++) {
+		for (uint16_t x = top_left.x; x <= bottom_right.x; x++) {
+			coord_2d_t pos = {.x = x, .y = y};
+			bad += (ili9341_emu_read_screen(emu, pos) != color);
+		}
+	}
+
+	return bad;
+}
+
+/*
+ * DMA complete interrupts during the init sequence must not advance the queue
+ * the init polls, no command may be skipped or overlap a running transfer.
+ */
+int _ili9341_test_init_async(void) {
+	int fails = 0;
+	ili9341_emu_stats_t stats = ili9341_emu_get_stats(ili9341_test_emu666);
+
+	fails += ILI9341_TEST_CHECK(ili9341_test_notified > 0);
+	fails += ILI9341_TEST_CHECK(stats.errors == 0);
+	fails += ILI9341_TEST_CHECK(ili9341_get_pixel_size(ili9341_test_desc666) == 3);
+	fails += ILI9341_TEST_CHECK(ili9341_get_screen_width(ili9341_test_desc666) == ILI9341_TEST_WIDTH);
+
+	return fails;
+}
+
+void _ili9341_test_sleep(uint32_t ms) {
+	(void)ms;
+}
+
+/*
+ * The SPI ready flag is polled with wait_yield, the blocking strategies are
+ * rejected without it rather than spinning there.
+ */
+int _ili9341_test_wait_cfg(void) {
+	int fails = 0;
+	ili9341_hw_cfg_t hw_cfg = ili9341_get_default_hw_cfg();
+	ili9341_cfg_t cfg = {.wait_strategy = ILI9341_WAIT_SLEEP, .wait_sleep = _ili9341_test_sleep};
+
+	ili9341_emu_get_hal(ili9341_test_emu, &cfg);
+	fails += ILI9341_TEST_CHECK(ili9341_init_start(&cfg, &hw_cfg) == NULL);
+	cfg.wait_strategy = ILI9341_WAIT_EVENT;
+	cfg.wait_event = _ili9341_test_sleep;
+	cfg.wait_signal = _ili9341_test_irq;
+	fails += ILI9341_TEST_CHECK(ili9341_init_start(&cfg, &hw_cfg) == NULL);
+
+	return fails;
+}
+
+int _ili9341_test_fill_repeat(void) {
+	int fails = 0;
+	coord_2d_t top_left = {.x = 0, .y = 0};
+	coord_2d_t bottom_right = {.x = ILI9341_TEST_WIDTH - 1, .y = ILI9341_TEST_HEIGHT - 1};
+
+	ili9341_emu_reset_stats(ili9341_test_emu);
+	fails += ILI9341_TEST_CHECK(ili9341_set_region(ili9341_test_desc, top_left, bottom_right) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_fill_region(ili9341_test_desc, 0x1234) == ILI9341_SUCCESS);
+
+	ili9341_emu_stats_t stats = ili9341_emu_get_stats(ili9341_test_emu);
+	fails += ILI9341_TEST_CHECK(stats.pixels == ILI9341_TEST_WIDTH * ILI9341_TEST_HEIGHT);
+	fails += ILI9341_TEST_CHECK(stats.errors == 0);
+	fails += ILI9341_TEST_CHECK(_ili9341_test_count_bad(ili9341_test_emu, top_left, bottom_right, 0x1234) == 0);
+
+	return fails;
+}
+
+int _ili9341_test_blit_sg(void) {
+	int fails = 0;
+	coord_2d_t top_left = {.x = 30, .y = 40};
+	uint16_t width = 50, height = 40, stride = ILI9341_TEST_WIDTH * 2;
+	uint32_t bad = 0;
+
+	ili9341_emu_reset_stats(ili9341_test_emu);
+	fails += ILI9341_TEST_CHECK(ili9341_blit_RGB565(ili9341_test_desc, top_left, ili9341_test_image,
+			stride, width, height) == ILI9341_SUCCESS);
+
+	for (uint16_t y = 0; y < height; y++) {
+		for (uint16_t x = 0; x < width; x++) {
+			const uint8_t* px = &ili9341_test_image[y * stride + x * 2];
+			coord_2d_t pos = {.x = top_left.x + x, .y = top_left.y + y};
+			bad += (ili9341_emu_read_screen(ili9341_test_emu, pos) != (((uint16_t)px[0] << 8) | px[1]));
+		}
+	}
+
+	ili9341_emu_stats_t stats = ili9341_emu_get_stats(ili9341_test_emu);
+	fails += ILI9341_TEST_CHECK(bad == 0);
+	fails += ILI9341_TEST_CHECK(stats.transfers < height);
+	fails += ILI9341_TEST_CHECK(stats.errors == 0);
+
+	return fails;
+}
+
+/*
+ * Draw across the wrap of the scrolling area, the payload is split into two
+ * windows. Screen line y of the scrolling area shows the frame memory line
+ * tfa + (y - tfa + offset) % vsa.
+ */
+int _ili9341_test_scroll_wrap(void) {
+	int fails = 0;
+	uint16_t tfa = ILI9341_TEST_SCROLL_TFA;
+	uint16_t vsa = ILI9341_TEST_HEIGHT - ILI9341_TEST_SCROLL_TFA - ILI9341_TEST_SCROLL_BFA;
+	uint16_t offset = 150;
+	coord_2d_t top_left = {.x = 0, .y = 100};
+	coord_2d_t bottom_right = {.x = ILI9341_TEST_WIDTH - 1, .y = 199};
+	uint32_t bad = 0;
+
+	fails += ILI9341_TEST_CHECK(ili9341_scroll_setup(ili9341_test_desc, tfa, ILI9341_TEST_SCROLL_BFA) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_scroll_set(ili9341_test_desc, offset) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_set_region(ili9341_test_desc, top_left, bottom_right) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_draw_RGB565_dma(ili9341_test_desc, ili9341_test_image,
+			sizeof(ili9341_test_image)) == ILI9341_SUCCESS);
+
+	for (uint16_t y = top_left.y; y <= bottom_right.y; y++) {
+		uint16_t line = tfa + (y - tfa + offset) % vsa;
+		for (uint16_t x = 0; x < ILI9341_TEST_WIDTH; x++) {
+			const uint8_t* px = &ili9341_test_image[((y - top_left.y) * ILI9341_TEST_WIDTH + x) * 2];
+			coord_2d_t pos = {.x = x, .y = line};
+			bad += (ili9341_emu_read_screen(ili9341_test_emu, pos) != (((uint16_t)px[0] << 8) | px[1]));
+		}
+	}
+	fails += ILI9341_TEST_CHECK(bad == 0);
+	fails += ILI9341_TEST_CHECK(ili9341_scroll_stop(ili9341_test_desc) == ILI9341_SUCCESS);
+
+	return fails;
+}
+
+/*
+ * Record a workload, clear the screen and replay the log, the frame memory
+ * must come out the same.
+ */
+int _ili9341_test_record_replay(void) {
+	static uint16_t expected[ILI9341_TEST_HEIGHT][ILI9341_TEST_WIDTH];
+	int fails = 0;
+	ili9341_rec_t rec;
+	coord_2d_t top_left = {.x = 0, .y = 0};
+	coord_2d_t bottom_right = {.x = ILI9341_TEST_WIDTH - 1, .y = ILI9341_TEST_HEIGHT - 1};
+	coord_2d_t blit_pos = {.x = 100, .y = 200};
+	uint32_t bad = 0;
+
+	fails += ILI9341_TEST_CHECK(ili9341_rec_start(&rec, ili9341_test_desc, ili9341_test_log,
+			sizeof(ili9341_test_log), true) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_set_region(ili9341_test_desc, top_left, bottom_right) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_fill_region(ili9341_test_desc, 0x07E0) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_blit_RGB565(ili9341_test_desc, blit_pos, ili9341_test_image,
+			ILI9341_TEST_WIDTH * 2, 60, 30) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_rec_stop(&rec) == ILI9341_SUCCESS);
+
+	for (uint16_t y = 0; y < ILI9341_TEST_HEIGHT; y++) {
+		for (uint16_t x = 0; x < ILI9341_TEST_WIDTH; x++) {
+			expected[y][x] = ili9341_emu_read_RGB565(ili9341_test_emu, x, y);
+		}
+	}
+
+	fails += ILI9341_TEST_CHECK(ili9341_set_region(ili9341_test_desc, top_left, bottom_right) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_fill_region(ili9341_test_desc, 0x0000) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_rec_replay(ili9341_test_desc, ili9341_test_log, rec.len, NULL) == ILI9341_SUCCESS);
+
+	for (uint16_t y = 0; y < ILI9341_TEST_HEIGHT; y++) {
+		for (uint16_t x = 0; x < ILI9341_TEST_WIDTH; x++) {
+			bad += (ili9341_emu_read_RGB565(ili9341_test_emu, x, y) != expected[y][x]);
+		}
+	}
+	fails += ILI9341_TEST_CHECK(bad == 0);
+
+	/* A truncated log is rejected. */
+	fails += ILI9341_TEST_CHECK(ili9341_rec_replay(ili9341_test_desc, ili9341_test_log, rec.len - 1, NULL) < 0);
+
+	return fails;
+}
+
+/*
+ * RGB565 drawn to the 18-bit display is expanded without loss, queued in
+ * dma_async mode.
+ */
+int _ili9341_test_rgb666_async(void) {
+	int fails = 0;
+	coord_2d_t top_left = {.x = 0, .y = 0};
+	coord_2d_t bottom_right = {.x = ILI9341_TEST_WIDTH - 1, .y = 99};
+	uint32_t bad = 0;
+
+	fails += ILI9341_TEST_CHECK(ili9341_set_region(ili9341_test_desc666, top_left, bottom_right) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_draw_RGB565_dma(ili9341_test_desc666, ili9341_test_image,
+			sizeof(ili9341_test_image)) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_wait_idle(ili9341_test_desc666) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(!ili9341_is_busy(ili9341_test_desc666));
+
+	for (uint16_t y = top_left.y; y <= bottom_right.y; y++) {
+		for (uint16_t x = 0; x < ILI9341_TEST_WIDTH; x++) {
+			const uint8_t* px = &ili9341_test_image[(y * ILI9341_TEST_WIDTH + x) * 2];
+			coord_2d_t pos = {.x = x, .y = y};
+			bad += (ili9341_emu_read_screen(ili9341_test_emu666, pos) != (((uint16_t)px[0] << 8) | px[1]));
+		}
+	}
+	fails += ILI9341_TEST_CHECK(bad == 0);
+	fails += ILI9341_TEST_CHECK(ili9341_emu_get_stats(ili9341_test_emu666).errors == 0);
+
+	return fails;
+}
+
+/*
+ * Start the TE pulses of the given period, with the phase cleared, once the
+ * commands sent so far are out.
+ */
+int _ili9341_test_te_start(uint32_t period) {
+	int err = ili9341_wait_idle(ili9341_test_desc666);
+	ili9341_test_te_period = period;
+	ili9341_test_te_phase = 0;
+	return err;
+}
+
+/*
+ * The frame period is measured anew after each ili9341_te_enable, the edges
+ * of the previous enable must not mix in.
+ */
+int _ili9341_test_te_reenable(void) {
+	int fails = 0;
+	ili9341_desc_ptr_t desc = ili9341_test_desc666;
+	coord_2d_t top_left = {.x = 0, .y = 200};
+	coord_2d_t bottom_right = {.x = ILI9341_TEST_WIDTH - 1, .y = 219};
+	uint32_t size = ILI9341_TEST_WIDTH * 20 * 2;
+
+	/* Right after the enable the edge completing the first period is waited for. */
+	fails += ILI9341_TEST_CHECK(ili9341_te_enable(desc, 0) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(_ili9341_test_te_start(10) == ILI9341_SUCCESS);
+	uint32_t start_ms = ili9341_get_uptime_ms(desc);
+	fails += ILI9341_TEST_CHECK(ili9341_te_wait_line(desc, 0) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_get_uptime_ms(desc) - start_ms == 11);
+
+	ili9341_test_te_period = 0;
+	fails += ILI9341_TEST_CHECK(ili9341_te_disable(desc) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_wait_idle(desc) == ILI9341_SUCCESS);
+	ili9341_emu_advance_ms(ili9341_test_emu666, 100);
+
+	/* Edges at 1 and 21 ms, then 13 ms for the scan to pass line 200 of 320. */
+	fails += ILI9341_TEST_CHECK(ili9341_te_enable(desc, 0) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(_ili9341_test_te_start(20) == ILI9341_SUCCESS);
+	start_ms = ili9341_get_uptime_ms(desc);
+	fails += ILI9341_TEST_CHECK(ili9341_te_wait_line(desc, top_left.y) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_get_uptime_ms(desc) - start_ms == 34);
+	fails += ILI9341_TEST_CHECK(ili9341_te_present(desc, top_left, bottom_right, ili9341_test_image, size) ==
+			ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_wait_idle(desc) == ILI9341_SUCCESS);
+
+	ili9341_test_te_period = 0;
+	fails += ILI9341_TEST_CHECK(ili9341_te_disable(desc) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_wait_idle(desc) == ILI9341_SUCCESS);
+
+	uint32_t bad = 0;
+	for (uint32_t i = 0; i < size / 2; i++) {
+		coord_2d_t pos = {.x = i % ILI9341_TEST_WIDTH, .y = top_left.y + i / ILI9341_TEST_WIDTH};
+		uint16_t color = ((uint16_t)ili9341_test_image[2 * i] << 8) | ili9341_test_image[2 * i + 1];
+		bad += (ili9341_emu_read_screen(ili9341_test_emu666, pos) != color);
+	}
+	fails += ILI9341_TEST_CHECK(bad == 0);
+
+	return fails;
+}
+
+/*
+ * A green gradient blitted with dithering gets the 6-bit green channel
+ * rounded by the 4x4 Bayer thresholds scaled to the step of 4.
+ */
+int _ili9341_test_dither_green(void) {
+	static const uint8_t bayer[4][4] = {
+		{0, 8, 2, 10},
+		{12, 4, 14, 6},
+		{3, 11, 1, 9},
+		{15, 7, 13, 5},
+	};
+	static uint8_t gradient[ILI9341_TEST_WIDTH * 4 * 3];
+	int fails = 0;
+	coord_2d_t top_left = {.x = 0, .y = 120};
+	uint32_t bad = 0;
+
+	for (uint32_t i = 0; i < ILI9341_TEST_WIDTH * 4; i++) {
+		gradient[3 * i] = 0;
+		gradient[3 * i + 1] = i % ILI9341_TEST_WIDTH;
+		gradient[3 * i + 2] = 0;
+	}
+	fails += ILI9341_TEST_CHECK(ili9341_blit_RGB888(ili9341_test_desc, top_left, gradient, ILI9341_TEST_WIDTH * 3,
+			ILI9341_TEST_WIDTH, 4, ILI9341_COLOR_DITHER) == ILI9341_SUCCESS);
+
+	for (uint16_t y = top_left.y; y < top_left.y + 4; y++) {
+		for (uint16_t x = 0; x < ILI9341_TEST_WIDTH; x++) {
+			coord_2d_t pos = {.x = x, .y = y};
+			uint16_t green = (x + (bayer[y & 3][x & 3] >> 2)) >> 2;
+			bad += (ili9341_emu_read_screen(ili9341_test_emu, pos) != (green << 5));
+		}
+	}
+	fails += ILI9341_TEST_CHECK(bad == 0);
+
+	return fails;
+}
+
+int _ili9341_test_images(ili9341_desc_ptr_t desc, ili9341_emu_ptr_t emu) {
+	int fails = 0;
+	ili9341_image_t rle = {20, 10, ILI9341_IMAGE_RLE, 0, NULL, ili9341_test_rle, sizeof(ili9341_test_rle)};
+	ili9341_image_t qoi = {20, 10, ILI9341_IMAGE_QOI, 0, NULL, ili9341_test_qoi, sizeof(ili9341_test_qoi)};
+	static const uint16_t literals[4] = {0x1234, 0x5678, 0x9ABC, 0xDEF0};
+	coord_2d_t pos = {.x = 10, .y = 20};
+	uint32_t bad = 0;
+
+	fails += ILI9341_TEST_CHECK(ili9341_draw_image(desc, pos, &rle) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_wait_idle(desc) == ILI9341_SUCCESS);
+	for (uint32_t i = 0; i < 200; i++) {
+		coord_2d_t px = {.x = pos.x + i % 20, .y = pos.y + i / 20};
+		uint16_t color = (i < 100) ? 0xF800 : (i < 104) ? literals[i - 100] : 0x001F;
+		bad += (ili9341_emu_read_screen(emu, px) != color);
+	}
+
+	pos.y += 20;
+	fails += ILI9341_TEST_CHECK(ili9341_draw_image(desc, pos, &qoi) == ILI9341_SUCCESS);
+	fails += ILI9341_TEST_CHECK(ili9341_wait_idle(desc) == ILI9341_SUCCESS);
+	for (uint32_t i = 0; i < 200; i++) {
+		coord_2d_t px = {.x = pos.x + i % 20, .y = pos.y + i / 20};
+		bad += (ili9341_emu_read_screen(emu, px) != ((i < 101) ? 0x07E0 : 0x001F));
+	}
+	fails += ILI9341_TEST_CHECK(bad == 0);
+
+	/* Corrupted data is rejected. */
+	qoi.size -= 1;
+	fails += ILI9341_TEST_CHECK(ili9341_draw_image(desc, pos, &qoi) == -ILI9341_ERR_INV_PARAM);
+
+	return fails;
+}
+
+int _ili9341_test_images_rgb565(void) {
+	return _ili9341_test_images(ili9341_test_desc, ili9341_test_emu);
+}
+
+int _ili9341_test_images_rgb666_async(void) {
+	int fails = _ili9341_test_images(ili9341_test_desc666, ili9341_test_emu666);
+	fails += ILI9341_TEST_CHECK(ili9341_wait_idle(ili9341_test_desc666) == ILI9341_SUCCESS);
+	return fails;
+}
+
+static const ili9341_test_t ili9341_tests[] = {
+	{"init_async", _ili9341_test_init_async},
+	{"wait_cfg", _ili9341_test_wait_cfg},
+	{"fill_repeat", _ili9341_test_fill_repeat},
+	{"blit_sg", _ili9341_test_blit_sg},
+	{"scroll_wrap", _ili9341_test_scroll_wrap},
+	{"record_replay", _ili9341_test_record_replay},
+	{"rgb666_async", _ili9341_test_rgb666_async},
+	{"images_rgb565", _ili9341_test_images_rgb565},
+	{"images_rgb666_async", _ili9341_test_images_rgb666_async},
+	{"te_reenable", _ili9341_test_te_reenable},
+	{"dither_green", _ili9341_test_dither_green},
+};
+
+/*
+ * Initialize the display on the emulator, the descriptor is published before
+ * the init sequence runs, as the platform interrupt handlers see it.
+ */
+int _ili9341_test_display(ili9341_emu_ptr_t emu, ili9341_cfg_t* cfg, uint8_t pixfmt, ili9341_desc_ptr_t* out) {
+	ili9341_hw_cfg_t hw_cfg = ili9341_get_default_hw_cfg();
+	hw_cfg.pixfmt.params[0] = pixfmt;
+
+	cfg->width = ILI9341_TEST_HEIGHT;
+	cfg->height = ILI9341_TEST_WIDTH;
+	cfg->orientation = ILI9341_ORIENTATION_VERTICAL;
+	cfg->timeout_ms = 1000;
+	ili9341_emu_get_hal(emu, cfg);
+	if (cfg->dma_async) {
+		ili9341_test_emu666_ready = cfg->spi_tx_ready;
+		cfg->spi_tx_ready = _ili9341_test_ready_isr;
+	}
+
+	ili9341_desc_ptr_t desc = ili9341_init_start(cfg, &hw_cfg);
+	if (desc == NULL) {
+		return -ILI9341_ERR_INV_PARAM;
+	}
+	*out = desc;
+	ili9341_emu_attach(emu, desc);
+	while (!ili9341_init_done(desc)) {
+		int err = ili9341_init_poll(desc);
+		if (err < 0) {
+			return err;
+		}
+		if (!ili9341_init_done(desc)) {
+			ili9341_emu_advance_ms(emu, 1);
+		}
+	}
+
+	return ILI9341_SUCCESS;
+}
+
+/* Public interface methods. */
+
+int main(void) {
+	ili9341_emu_cfg_t emu_cfg = {.repeat = true, .sg = true, .tick = true};
+	ili9341_emu_cfg_t emu666_cfg = {.tick = true};
+	ili9341_cfg_t cfg = {0};
+	ili9341_cfg_t cfg666 = {
+		.dma_async = true,
+		.wait_strategy = ILI9341_WAIT_YIELD,
+		.wait_yield = _ili9341_test_irq,
+	};
+
+	for (uint32_t i = 0; i < sizeof(ili9341_test_image) / 2; i++) {
+		uint16_t color = _ili9341_test_color(i);
+		ili9341_test_image[2 * i] = color >> 8;
+		ili9341_test_image[2 * i + 1] = color & 0xFF;
+	}
+
+	ili9341_test_emu = ili9341_emu_create(&emu_cfg);
+	ili9341_test_emu666 = ili9341_emu_create(&emu666_cfg);
+	if (_ili9341_test_display(ili9341_test_emu, &cfg, ILI9341_PIXFMT_16BIT, &ili9341_test_desc) < 0 ||
+			_ili9341_test_display(ili9341_test_emu666, &cfg666, ILI9341_PIXFMT_18BIT, &ili9341_test_desc666) < 0) {
+		printf("FAIL display init\n");
+		return 1;
+	}
+
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(ili9341_tests) / sizeof(ili9341_tests[0]); i++) {
+		int fails = ili9341_tests[i].fn();
+		printf("%s %s\n", fails ? "FAIL" : "ok  ", ili9341_tests[i].name);
+		failed += (fails > 0);
+	}
+
+	return failed ? 1 : 0;
+}
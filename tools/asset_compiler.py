@@ -0,0 +1,443 @@
+#!/usr/bin/env python3
+"""
+Asset compiler for ILI9341 driver
+
+Converts PNG and PPM images to C arrays of ili9341_image_t (ili9341_image.h).
+Every image is encoded as raw RGB565, palette indexed, RLE and QOI-style, and
+the best encoding is picked according to the policy:
+
+  size   - the smallest data (default),
+  speed  - the cheapest to decode, then the smallest,
+  cost:N - the smallest one decoding in at most N cycles per pixel on average.
+
+Usage:
+
+  python3 tools/asset_compiler.py -o assets.h [--policy size] [--report report.txt] \\
+      logo.png background.ppm
+
+Only the Python 3 standard library is needed.
+
+Author: Michal Horn
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import zlib
+
+RUN_FILL_MIN = 32        # ILI9341_IMAGE_RUN_FILL_MIN
+QOI_INDEX_LEN = 64       # ILI9341_IMAGE_QOI_INDEX_LEN
+
+# Rough decode cost in CPU cycles per pixel produced by the decoder, pixels of
+# long runs are sent as fills and cost nothing. Raw images are sent by DMA
+# straight from flash.
+COST_INDEXED = 6
+COST_RLE = 4
+COST_QOI = 10
+
+
+# Image loading
+
+def load_ppm(path):
+    with open(path, "rb") as f:
+        data = f.read()
+
+    # Header tokens, comments skipped.
+    tokens = []
+    pos = 0
+    while len(tokens) < 4:
+        m = re.compile(rb"\s*(#[^\n]*\n\s*)*(\S+)").match(data, pos)
+        if m is None:
+            raise ValueError("%s: truncated PPM header" % path)
+        tokens.append(m.group(2))
+        pos = m.end()
+
+    magic, width, height, maxval = tokens[0], int(tokens[1]), int(tokens[2]), int(tokens[3])
+    if magic == b"P6":
+        pos += 1
+        sample = 2 if maxval > 255 else 1
+        raw = data[pos:pos + width * height * 3 * sample]
+        if sample == 2:
+            values = [raw[i] for i in range(0, len(raw), 2)]
+            maxval >>= 8
+        else:
+            values = list(raw)
+    elif magic == b"P3":
+        values = [int(v) for v in data[pos:].split()]
+    else:
+        raise ValueError("%s: unsupported PPM type %s" % (path, magic.decode()))
+
+    if len(values) < width * height * 3:
+        raise ValueError("%s: truncated PPM data" % path)
+
+    pixels = []
+    for i in range(width * height):
+        r, g, b = values[3 * i:3 * i + 3]
+        pixels.append((r * 255 // maxval, g * 255 // maxval, b * 255 // maxval, 255))
+    return width, height, pixels
+
+
+def _png_unfilter(raw, width, height, bpp_bits):
+    stride = (width * bpp_bits + 7) // 8
+    step = max(1, bpp_bits // 8)
+    lines = []
+    prev = bytearray(stride)
+    pos = 0
+    for _ in range(height):
+        ftype = raw[pos]
+        line = bytearray(raw[pos + 1:pos + 1 + stride])
+        pos += 1 + stride
+        for i in range(stride):
+            a = line[i - step] if i >= step else 0
+            b = prev[i]
+            c = prev[i - step] if i >= step else 0
+            if ftype == 1:
+                line[i] = (line[i] + a) & 0xFF
+            elif ftype == 2:
+                line[i] = (line[i] + b) & 0xFF
+            elif ftype == 3:
+                line[i] = (line[i] + ((a + b) >> 1)) & 0xFF
+            elif ftype == 4:
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                pred = a if pa <= pb and pa <= pc else (b if pb <= pc else c)
+                line[i] = (line[i] + pred) & 0xFF
+            elif ftype != 0:
+                raise ValueError("unknown PNG filter %d" % ftype)
+        lines.append(line)
+        prev = line
+    return lines
+
+
+def load_png(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        raise ValueError("%s: not a PNG file" % path)
+
+    pos = 8
+    idat = bytearray()
+    palette = []
+    trns = b""
+    while pos < len(data):
+        length, ctype = struct.unpack(">I4s", data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if ctype == b"IHDR":
+            width, height, depth, color, _, _, interlace = struct.unpack(">IIBBBBB", body)
+        elif ctype == b"PLTE":
+            palette = [tuple(body[i:i + 3]) for i in range(0, len(body), 3)]
+        elif ctype == b"tRNS":
+            trns = body
+        elif ctype == b"IDAT":
+            idat += body
+        elif ctype == b"IEND":
+            break
+
+    if interlace:
+        raise ValueError("%s: interlaced PNG is not supported" % path)
+
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[color]
+    lines = _png_unfilter(zlib.decompress(bytes(idat)), width, height, channels * depth)
+
+    pixels = []
+    for line in lines:
+        if depth < 8:
+            mask = (1 << depth) - 1
+            samples = [(line[(x * depth) // 8] >> (8 - depth - (x * depth) % 8)) & mask for x in range(width)]
+        elif depth == 16:
+            samples = list(line[0::2])
+        else:
+            samples = list(line)
+
+        for x in range(width):
+            s = samples[x * channels:(x + 1) * channels]
+            if color == 3:
+                r, g, b = palette[s[0]]
+                a = trns[s[0]] if s[0] < len(trns) else 255
+            elif color in (0, 4):
+                v = s[0] * 255 // ((1 << depth) - 1) if depth < 8 else s[0]
+                r = g = b = v
+                a = s[1] if color == 4 else 255
+            else:
+                r, g, b = s[0:3]
+                a = s[3] if color == 6 else 255
+            pixels.append((r, g, b, a))
+    return width, height, pixels
+
+
+def load_image(path, background):
+    if path.lower().endswith(".png"):
+        width, height, pixels = load_png(path)
+    else:
+        width, height, pixels = load_ppm(path)
+
+    # RGB565 with the alpha blended over the background color.
+    colors = []
+    for r, g, b, a in pixels:
+        r = (r * a + background[0] * (255 - a)) // 255
+        g = (g * a + background[1] * (255 - a)) // 255
+        b = (b * a + background[2] * (255 - a)) // 255
+        colors.append((((r * 31 + 127) // 255) << 11) | (((g * 63 + 127) // 255) << 5) | ((b * 31 + 127) // 255))
+    return width, height, colors
+
+
+# Encoders, matching the decoders of ili9341_image.c
+
+class Encoding:
+    def __init__(self, fmt, data, cost, bpp=0, palette=None):
+        self.fmt = fmt
+        self.data = bytes(data)
+        self.cost = cost
+        self.bpp = bpp
+        self.palette = palette
+
+
+def decoded_pixels(runs, total):
+    """Pixels decoded by the CPU, i.e. not in runs sent as fills."""
+    return total - sum(n for n in runs if n >= RUN_FILL_MIN)
+
+
+def encode_raw(width, height, colors):
+    data = bytearray()
+    for c in colors:
+        data.extend(bytes((c >> 8, c & 0xFF)))
+    return Encoding("ILI9341_IMAGE_RGB565", data, 0)
+
+
+def encode_indexed(width, height, colors):
+    counts = {}
+    for c in colors:
+        counts[c] = counts.get(c, 0) + 1
+    if len(counts) > 256:
+        return None
+
+    palette = sorted(counts, key=lambda c: -counts[c])
+    bpp = next(b for b in (1, 2, 4, 8) if len(palette) <= (1 << b))
+    lookup = {c: i for i, c in enumerate(palette)}
+
+    data = bytearray()
+    for y in range(height):
+        acc = 0
+        bits = 0
+        for c in colors[y * width:(y + 1) * width]:
+            acc = (acc << bpp) | lookup[c]
+            bits += bpp
+            if bits == 8:
+                data.append(acc)
+                acc = 0
+                bits = 0
+        if bits:
+            data.append(acc << (8 - bits))
+
+    palette += [0] * ((1 << bpp) - len(palette))
+    return Encoding("ILI9341_IMAGE_INDEXED", data, COST_INDEXED, bpp, palette)
+
+
+def encode_rle(width, height, colors):
+    data = bytearray()
+    runs = []
+    literal = []
+
+    def header(run, count):
+        c = count - 1
+        flag = 0x80 if run else 0x00
+        if c < 64:
+            data.append(flag | c)
+        else:
+            data.extend(bytes((flag | 0x40 | (c >> 8), c & 0xFF)))
+
+    def flush_literal():
+        while literal:
+            chunk = literal[:16384]
+            del literal[:16384]
+            header(False, len(chunk))
+            for c in chunk:
+                data.extend(bytes((c >> 8, c & 0xFF)))
+
+    i = 0
+    while i < len(colors):
+        j = i
+        while j < len(colors) and colors[j] == colors[i] and j - i < 16384:
+            j += 1
+        # A run packet takes 3 bytes, the same pixels as literals 2 bytes each.
+        if j - i >= 3 or (j - i == 2 and not literal):
+            flush_literal()
+            header(True, j - i)
+            data.extend(bytes((colors[i] >> 8, colors[i] & 0xFF)))
+            runs.append(j - i)
+        else:
+            literal += colors[i:j]
+        i = j
+    flush_literal()
+
+    return Encoding("ILI9341_IMAGE_RLE", data, COST_RLE * decoded_pixels(runs, len(colors)) / len(colors))
+
+
+def qoi_hash(c):
+    return (((c >> 11) & 0x1F) * 3 + ((c >> 5) & 0x3F) * 5 + (c & 0x1F) * 7) % QOI_INDEX_LEN
+
+
+def encode_qoi(width, height, colors):
+    data = bytearray()
+    runs = []
+    index = [0] * QOI_INDEX_LEN
+    prev = 0
+    run = 0
+
+    def flush_run(run):
+        if run >= RUN_FILL_MIN:
+            runs.append(run)
+        while run > 0:
+            if run <= 62:
+                data.append(0xC0 | (run - 1))
+                run = 0
+            else:
+                n = min(run, 65536)
+                data.extend(bytes((0xFF, (n - 1) >> 8, (n - 1) & 0xFF)))
+                run -= n
+
+    for c in colors:
+        if c == prev:
+            run += 1
+            continue
+        flush_run(run)
+        run = 0
+
+        h = qoi_hash(c)
+        if index[h] == c:
+            data.append(h)
+        else:
+            dr = (((c >> 11) - (prev >> 11) + 16) & 0x1F) - 16
+            dg = ((((c >> 5) & 0x3F) - ((prev >> 5) & 0x3F) + 32) & 0x3F) - 32
+            db = (((c & 0x1F) - (prev & 0x1F) + 16) & 0x1F) - 16
+            if -2 <= dr <= 1 and -2 <= dg <= 1 and -2 <= db <= 1:
+                data.append(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2))
+            elif -8 <= dr <= 7 and -8 <= db <= 7:
+                data.extend(bytes((0x80 | (dg + 32), ((dr + 8) << 4) | (db + 8))))
+            else:
+                data.extend(bytes((0xFE, c >> 8, c & 0xFF)))
+        index[h] = c
+        prev = c
+    flush_run(run)
+
+    return Encoding("ILI9341_IMAGE_QOI", data, COST_QOI * decoded_pixels(runs, len(colors)) / len(colors))
+
+
+def pick(encodings, policy):
+    if policy == "speed":
+        return min(encodings, key=lambda e: (e.cost, len(e.data)))
+    if policy.startswith("cost:"):
+        limit = float(policy[5:])
+        fitting = [e for e in encodings if e.cost <= limit]
+        return min(fitting, key=lambda e: len(e.data))
+    return min(encodings, key=lambda e: (len(e.data), e.cost))
+
+
+# Output
+
+def c_bytes(data, indent="\t"):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append(indent + ", ".join("0x%02X" % b for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def emit(name, width, height, enc, raw_size):
+    out = []
+    out.append("/* %s: %dx%d, %s, %d bytes (raw %d), decode cost ~%.1f cycles per pixel */"
+               % (name, width, height, enc.fmt, len(enc.data), raw_size, enc.cost))
+    out.append("#define %s_DECODE_COST %d" % (name.upper(), round(enc.cost * width * height)))
+    out.append("")
+    out.append("static const uint8_t %s_data[%d] = {" % (name, len(enc.data)))
+    out.append(c_bytes(enc.data))
+    out.append("};")
+    out.append("")
+    palette = "NULL"
+    if enc.palette is not None:
+        palette = "%s_palette" % name
+        out.append("static const uint16_t %s[%d] = {" % (palette, len(enc.palette)))
+        for i in range(0, len(enc.palette), 8):
+            out.append("\t" + ", ".join("0x%04X" % c for c in enc.palette[i:i + 8]) + ",")
+        out.append("};")
+        out.append("")
+    out.append("static const ili9341_image_t %s = {" % name)
+    out.append("\t.width = %d," % width)
+    out.append("\t.height = %d," % height)
+    out.append("\t.format = %s," % enc.fmt)
+    out.append("\t.bpp = %d," % enc.bpp)
+    out.append("\t.palette = %s," % palette)
+    out.append("\t.data = %s_data," % name)
+    out.append("\t.size = sizeof(%s_data)," % name)
+    out.append("};")
+    out.append("")
+    return "\n".join(out)
+
+
+def asset_name(path):
+    name = re.sub(r"\W", "_", os.path.splitext(os.path.basename(path))[0]).lower()
+    return name if not name[0].isdigit() else "img_" + name
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="Convert PNG and PPM images to ILI9341 driver images.")
+    parser.add_argument("images", nargs="+", help="PNG or PPM files")
+    parser.add_argument("-o", "--output", required=True, help="generated C header")
+    parser.add_argument("--policy", default="size", help="size, speed or cost:N, default size")
+    parser.add_argument("--background", default="000000", help="RRGGBB color transparent pixels are blended with")
+    parser.add_argument("--report", help="write the report to this file instead of stdout")
+    args = parser.parse_args(argv)
+
+    if args.policy not in ("size", "speed") and not re.match(r"^cost:\d+(\.\d+)?$", args.policy):
+        parser.error("unknown policy %s" % args.policy)
+    background = tuple(int(args.background[i:i + 2], 16) for i in (0, 2, 4))
+
+    guard = re.sub(r"\W", "_", os.path.basename(args.output)).upper() + "_"
+    body = ["/*", " * Generated by tools/asset_compiler.py, do not edit.", " */", "",
+            "#ifndef %s" % guard, "#define %s" % guard, "", '#include "ili9341_image.h"', ""]
+    report = ["%-24s %9s %9s %9s %9s %9s  %s" % ("asset", "raw", "indexed", "rle", "qoi", "chosen", "format")]
+    total_raw = 0
+    total_out = 0
+
+    for path in args.images:
+        width, height, colors = load_image(path, background)
+        candidates = [encode_raw(width, height, colors), encode_rle(width, height, colors),
+                      encode_qoi(width, height, colors)]
+        indexed = encode_indexed(width, height, colors)
+        if indexed is not None:
+            candidates.append(indexed)
+
+        enc = pick(candidates, args.policy)
+        name = asset_name(path)
+        raw_size = width * height * 2
+        body.append(emit(name, width, height, enc, raw_size))
+
+        sizes = {e.fmt: len(e.data) for e in candidates}
+        report.append("%-24s %9d %9s %9d %9d %9d  %s" % (
+            name, raw_size, sizes.get("ILI9341_IMAGE_INDEXED", "-"), sizes["ILI9341_IMAGE_RLE"],
+            sizes["ILI9341_IMAGE_QOI"], len(enc.data), enc.fmt))
+        total_raw += raw_size
+        total_out += len(enc.data)
+
+    body.append("#endif /* %s */" % guard)
+    body.append("")
+    with open(args.output, "w") as f:
+        f.write("\n".join(body))
+
+    saved = total_raw - total_out
+    report.append("")
+    report.append("total %d bytes, raw RGB565 %d bytes, saved %d bytes (%.1f %%)"
+                  % (total_out, total_raw, saved, 100.0 * saved / total_raw if total_raw else 0))
+    text = "\n".join(report) + "\n"
+    if args.report:
+        with open(args.report, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))